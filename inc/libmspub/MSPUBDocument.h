@@ -28,13 +28,50 @@
 
 namespace libmspub
 {
+
+//! The generation of the file format of a document
+enum MSPUBVersion
+{
+  MSPUB_UNKNOWN_VERSION = 0,
+  MSPUB_1, //!< Publisher 1 and 2, a flat file
+  MSPUB_2K, //!< Publisher 3 to 2000
+  MSPUB_2K2 //!< Publisher 2002 and later
+};
+
+//! What MSPUBDocument::probe finds about a document
+struct MSPUBDocumentInfo
+{
+  MSPUBDocumentInfo()
+    : m_version(MSPUB_UNKNOWN_VERSION)
+    , m_numPages(0)
+    , m_numMasterPages(0)
+    , m_width(0)
+    , m_height(0)
+  {
+  }
+  MSPUBVersion m_version;
+  unsigned m_numPages;
+  unsigned m_numMasterPages;
+  //! the page size in inches, 0 if it is not known
+  double m_width;
+  double m_height;
+};
+
 class MSPUBDocument
 {
 public:
 
   static PUBAPI bool isSupported(librevenge::RVNGInputStream *input);
 
+  static PUBAPI bool probe(librevenge::RVNGInputStream *input, MSPUBDocumentInfo &info);
+
+  static PUBAPI bool parseMetaData(librevenge::RVNGInputStream *input, librevenge::RVNGPropertyList &metaData);
+
+  static PUBAPI bool parseThumbnail(librevenge::RVNGInputStream *input, librevenge::RVNGBinaryData &thumbnail, librevenge::RVNGString &mimeType);
+
   static PUBAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter);
+
+  static PUBAPI bool parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, unsigned firstPage, unsigned lastPage);
 };
 
 } // namespace libmspub
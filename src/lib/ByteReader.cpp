@@ -0,0 +1,34 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ByteReader.h"
+
+namespace libmspub
+{
+
+ByteReader::ByteReader(librevenge::RVNGInputStream *input, unsigned long length)
+  : m_data(nullptr)
+  , m_size(0)
+  , m_origin(0)
+  , m_pos(0)
+{
+  if (!input)
+    return;
+  const long pos = input->tell();
+  m_origin = pos < 0 ? 0 : static_cast<unsigned long>(pos);
+  if (length == 0 || input->isEnd())
+    return;
+  unsigned long numBytesRead = 0;
+  m_data = input->read(length, numBytesRead);
+  m_size = m_data ? numBytesRead : 0;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,150 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_BYTEREADER_H
+#define INCLUDED_BYTEREADER_H
+
+#include <vector>
+
+#include <boost/cstdint.hpp>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "libmspub_utils.h"
+
+namespace libmspub
+{
+
+/** A bounds-checked little-endian cursor over a contiguous block of bytes.
+
+    Positions are expressed in the coordinates of the stream the block was
+    taken from, so offsets found in the file can be used directly. Reading
+    past the end of the block throws EndOfStreamException, like the
+    stream-based readU8/readU16/... do.
+
+    The reader does not own its bytes: when it is created from a stream, the
+    block is only valid until the next read on that stream.
+  */
+class ByteReader
+{
+public:
+  ByteReader()
+    : m_data(nullptr)
+    , m_size(0)
+    , m_origin(0)
+    , m_pos(0)
+  {
+  }
+  ByteReader(const unsigned char *data, unsigned long size, unsigned long origin = 0)
+    : m_data(data)
+    , m_size(data ? size : 0)
+    , m_origin(origin)
+    , m_pos(0)
+  {
+  }
+  //! Reads up to length bytes of input, starting at its current position, in one call.
+  ByteReader(librevenge::RVNGInputStream *input, unsigned long length);
+
+  unsigned long tell() const
+  {
+    return m_origin + m_pos;
+  }
+  //! Moves to the absolute stream offset pos; returns false if it is not inside the block.
+  bool seek(unsigned long pos)
+  {
+    if (pos < m_origin || pos - m_origin > m_size)
+      return false;
+    m_pos = pos - m_origin;
+    return true;
+  }
+  void skip(unsigned long length)
+  {
+    checkAvailable(length);
+    m_pos += length;
+  }
+  bool isEnd() const
+  {
+    return m_pos >= m_size;
+  }
+  unsigned long remaining() const
+  {
+    return m_size - m_pos;
+  }
+  //! Returns true while the cursor is inside the block and before the stream offset until.
+  bool stillReading(unsigned long until) const
+  {
+    return !isEnd() && tell() < until;
+  }
+  //! Returns a pointer to the bytes at the current position.
+  const unsigned char *current() const
+  {
+    return m_data + m_pos;
+  }
+
+  uint8_t readU8()
+  {
+    checkAvailable(1);
+    return m_data[m_pos++];
+  }
+  uint16_t readU16()
+  {
+    checkAvailable(2);
+    const unsigned char *p = m_data + m_pos;
+    m_pos += 2;
+    return uint16_t(unsigned(p[0]) | (unsigned(p[1]) << 8));
+  }
+  uint32_t readU32()
+  {
+    checkAvailable(4);
+    const unsigned char *p = m_data + m_pos;
+    m_pos += 4;
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  }
+  uint64_t readU64()
+  {
+    const uint64_t low = readU32();
+    return low | (uint64_t(readU32()) << 32);
+  }
+  int8_t readS8()
+  {
+    return int8_t(readU8());
+  }
+  int16_t readS16()
+  {
+    return int16_t(readU16());
+  }
+  int32_t readS32()
+  {
+    return int32_t(readU32());
+  }
+  //! Copies the next length bytes into out.
+  void readNBytes(unsigned long length, std::vector<unsigned char> &out)
+  {
+    checkAvailable(length);
+    out.assign(m_data + m_pos, m_data + m_pos + length);
+    m_pos += length;
+  }
+
+private:
+  void checkAvailable(unsigned long length) const
+  {
+    if (length > m_size - m_pos)
+      throw EndOfStreamException();
+  }
+
+  const unsigned char *m_data;
+  unsigned long m_size;
+  unsigned long m_origin;
+  unsigned long m_pos;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_BYTEREADER_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
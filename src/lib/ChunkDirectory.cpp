@@ -0,0 +1,58 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ChunkDirectory.h"
+
+namespace libmspub
+{
+
+ChunkDirectory::ChunkDirectory()
+  : m_chunks()
+  , m_indexBySeqNum()
+  , m_childIndicesByParent()
+{
+}
+
+unsigned ChunkDirectory::push_back(const ContentChunkReference &chunk)
+{
+  const auto index = unsigned(m_chunks.size());
+  m_chunks.push_back(chunk);
+  m_indexBySeqNum[chunk.seqNum] = index;
+  m_childIndicesByParent[chunk.parentSeqNum].push_back(index);
+  return index;
+}
+
+bool ChunkDirectory::findIndex(unsigned seqNum, unsigned &index) const
+{
+  const auto it = m_indexBySeqNum.find(seqNum);
+  if (it == m_indexBySeqNum.end())
+    return false;
+  index = it->second;
+  return true;
+}
+
+const ContentChunkReference *ChunkDirectory::find(unsigned seqNum) const
+{
+  unsigned index;
+  if (!findIndex(seqNum, index))
+    return nullptr;
+  return &m_chunks[index];
+}
+
+const std::vector<unsigned> *ChunkDirectory::getChildIndices(unsigned parentSeqNum) const
+{
+  const auto it = m_childIndicesByParent.find(parentSeqNum);
+  if (it == m_childIndicesByParent.end())
+    return nullptr;
+  return &it->second;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
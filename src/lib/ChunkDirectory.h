@@ -0,0 +1,103 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_CHUNKDIRECTORY_H
+#define INCLUDED_CHUNKDIRECTORY_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "MSPUBTypes.h"
+
+namespace libmspub
+{
+
+/** The list of content chunks of a document, indexed by sequence number.
+
+    Chunks keep the order in which they were added; each one is also
+    registered by its seqNum and in the child list of its parentSeqNum,
+    so both lookups are done without scanning the list. The seqNum and
+    parentSeqNum of a chunk must not be modified once it is added.
+  */
+class ChunkDirectory
+{
+public:
+  typedef std::vector<ContentChunkReference>::iterator iterator;
+  typedef std::vector<ContentChunkReference>::const_iterator const_iterator;
+
+  ChunkDirectory();
+
+  //! Adds a chunk and returns its index.
+  unsigned push_back(const ContentChunkReference &chunk);
+  //! Finds the index of the chunk with a given seqNum (the last added one if several share it).
+  bool findIndex(unsigned seqNum, unsigned &index) const;
+  //! Returns the chunk with a given seqNum, or nullptr.
+  const ContentChunkReference *find(unsigned seqNum) const;
+  //! Returns the indices of the children of parentSeqNum, or nullptr if it has none.
+  const std::vector<unsigned> *getChildIndices(unsigned parentSeqNum) const;
+
+  bool empty() const
+  {
+    return m_chunks.empty();
+  }
+  std::size_t size() const
+  {
+    return m_chunks.size();
+  }
+  ContentChunkReference &operator[](std::size_t i)
+  {
+    return m_chunks[i];
+  }
+  const ContentChunkReference &operator[](std::size_t i) const
+  {
+    return m_chunks[i];
+  }
+  ContentChunkReference &at(std::size_t i)
+  {
+    return m_chunks.at(i);
+  }
+  const ContentChunkReference &at(std::size_t i) const
+  {
+    return m_chunks.at(i);
+  }
+  ContentChunkReference &back()
+  {
+    return m_chunks.back();
+  }
+  const ContentChunkReference &back() const
+  {
+    return m_chunks.back();
+  }
+  iterator begin()
+  {
+    return m_chunks.begin();
+  }
+  iterator end()
+  {
+    return m_chunks.end();
+  }
+  const_iterator begin() const
+  {
+    return m_chunks.begin();
+  }
+  const_iterator end() const
+  {
+    return m_chunks.end();
+  }
+
+private:
+  std::vector<ContentChunkReference> m_chunks;
+  std::unordered_map<unsigned, unsigned> m_indexBySeqNum;
+  std::unordered_map<unsigned, std::vector<unsigned> > m_childIndicesByParent;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_CHUNKDIRECTORY_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,124 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "EscherIndex.h"
+
+#include <utility>
+
+#include "ByteReader.h"
+#include "EscherContainerType.h"
+#include "libmspub_utils.h"
+
+namespace libmspub
+{
+
+EscherIndex::EscherIndex()
+  : m_records()
+{
+}
+
+void EscherIndex::clear()
+{
+  m_records.clear();
+}
+
+unsigned EscherIndex::getTailLength(unsigned short type)
+{
+  switch (type)
+  {
+  case OFFICE_ART_DGG_CONTAINER:
+  case OFFICE_ART_DG_CONTAINER:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+bool EscherIndex::isContainer(unsigned short type)
+{
+  switch (type)
+  {
+  case OFFICE_ART_DGG_CONTAINER:
+  case OFFICE_ART_B_STORE_CONTAINER:
+  case OFFICE_ART_DG_CONTAINER:
+  case OFFICE_ART_SPGR_CONTAINER:
+  case OFFICE_ART_SP_CONTAINER:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void EscherIndex::build(librevenge::RVNGInputStream *input)
+{
+  m_records.clear();
+  const unsigned long start = static_cast<unsigned long>(input->tell());
+  const unsigned long length = getLength(input);
+  if (length <= start)
+    return;
+  ByteReader reader(input, length - start);
+
+  // the containers which are being filled, with the end of their contents
+  std::vector<std::pair<unsigned, unsigned long> > open;
+  unsigned long pos = start;
+  for (;;)
+  {
+    while (!open.empty() && pos >= open.back().second)
+    {
+      Record &container = m_records[open.back().first];
+      container.m_end = size();
+      pos = container.m_info.contentsOffset + container.m_info.contentsLength + getTailLength(container.m_info.type);
+      open.pop_back();
+    }
+    if (!reader.seek(pos) || reader.remaining() < 8)
+      break;
+    Record record;
+    record.m_info.initial = reader.readU16();
+    record.m_info.type = reader.readU16();
+    record.m_info.contentsLength = reader.readU32();
+    record.m_info.contentsOffset = reader.tell();
+    const unsigned id = size();
+    record.m_end = id + 1;
+    m_records.push_back(record);
+    MSPUB_DEBUG_MSG(("EscherIndex::build: record %u of type 0x%x, contentsOffset 0x%lx, contentsLength 0x%lx, depth %u\n", id, record.m_info.type, record.m_info.contentsOffset, record.m_info.contentsLength, unsigned(open.size())));
+    if (isContainer(record.m_info.type))
+    {
+      open.push_back(std::make_pair(id, record.m_info.contentsOffset + record.m_info.contentsLength));
+      pos = record.m_info.contentsOffset;
+    }
+    else
+      pos = record.m_info.contentsOffset + record.m_info.contentsLength + getTailLength(record.m_info.type);
+  }
+  // the stream is truncated
+  for (auto const &container : open)
+    m_records[container.first].m_end = size();
+}
+
+bool EscherIndex::findChild(unsigned parent, unsigned short type, unsigned &child) const
+{
+  return findChild(parent, type, type, child);
+}
+
+bool EscherIndex::findChild(unsigned parent, unsigned short type1, unsigned short type2, unsigned &child) const
+{
+  for (unsigned id = firstChild(parent); id < childrenEnd(parent); id = nextSibling(id))
+  {
+    const unsigned short type = m_records[id].m_info.type;
+    if (type == type1 || type == type2)
+    {
+      child = id;
+      return true;
+    }
+  }
+  return false;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
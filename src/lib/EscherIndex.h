@@ -0,0 +1,85 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_ESCHERINDEX_H
+#define INCLUDED_ESCHERINDEX_H
+
+#include <vector>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "MSPUBTypes.h"
+
+namespace libmspub
+{
+
+/** Flat index of the records of an Escher stream.
+
+    The records are stored in file order; the descendants of a record
+    directly follow it, so the children of a record are visited with
+    firstChild/nextSibling until childrenEnd.
+  */
+class EscherIndex
+{
+public:
+  //! The pseudo-record whose children are the top-level records.
+  static const unsigned ROOT = ~0u;
+
+  EscherIndex();
+
+  //! Indexes the records from the current position of input up to its end.
+  void build(librevenge::RVNGInputStream *input);
+  void clear();
+
+  unsigned size() const
+  {
+    return unsigned(m_records.size());
+  }
+  const EscherContainerInfo &get(unsigned id) const
+  {
+    return m_records[id].m_info;
+  }
+  unsigned firstChild(unsigned parent) const
+  {
+    return parent == ROOT ? 0 : parent + 1;
+  }
+  unsigned childrenEnd(unsigned parent) const
+  {
+    return parent == ROOT ? size() : m_records[parent].m_end;
+  }
+  unsigned nextSibling(unsigned id) const
+  {
+    return m_records[id].m_end;
+  }
+  //! Finds the first child of parent whose type is type.
+  bool findChild(unsigned parent, unsigned short type, unsigned &child) const;
+  //! Finds the first child of parent whose type is type1 or type2.
+  bool findChild(unsigned parent, unsigned short type1, unsigned short type2, unsigned &child) const;
+
+  //! Returns the length of the unexplained data which follows the contents of some records.
+  static unsigned getTailLength(unsigned short type);
+
+private:
+  struct Record
+  {
+    Record() : m_info(), m_end(0) { }
+    EscherContainerInfo m_info;
+    //! Index following the last descendant of this record.
+    unsigned m_end;
+  };
+
+  static bool isContainer(unsigned short type);
+
+  std::vector<Record> m_records;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_ESCHERINDEX_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -9,6 +9,7 @@
 
 #include "Fill.h"
 
+#include <tuple>
 #include <utility>
 
 #include "FillType.h"
@@ -31,11 +32,12 @@ ImgFill::ImgFill(unsigned imgIndex, const MSPUBCollector *owner, bool isTexture,
 void ImgFill::getProperties(librevenge::RVNGPropertyList *out) const
 {
   out->insert("draw:fill", "bitmap");
-  if (m_imgIndex > 0 && m_imgIndex <= m_owner->m_images.size())
+  const std::pair<ImgType, librevenge::RVNGBinaryData> *const imgPtr = m_owner->getImage(m_imgIndex);
+  if (imgPtr)
   {
-    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = m_owner->m_images[m_imgIndex - 1];
+    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = *imgPtr;
     out->insert("librevenge:mime-type", mimeByImgType(img.first));
-    out->insert("draw:fill-image", img.second.getBase64Data());
+    out->insert("draw:fill-image", m_owner->getImageBase64(m_imgIndex));
     out->insert("draw:fill-image-ref-point", "top-left");
     if (! m_isTexture)
     {
@@ -59,29 +61,37 @@ void PatternFill::getProperties(librevenge::RVNGPropertyList *out) const
   Color fgColor = m_fg.getFinalColor(m_owner->m_paletteColors);
   Color bgColor = m_bg.getFinalColor(m_owner->m_paletteColors);
   out->insert("draw:fill", "bitmap");
-  if (m_imgIndex > 0 && m_imgIndex <= m_owner->m_images.size())
+  const std::pair<ImgType, librevenge::RVNGBinaryData> *const imgPtr = m_owner->getImage(m_imgIndex);
+  if (imgPtr)
   {
-    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = m_owner->m_images[m_imgIndex - 1];
+    const std::pair<ImgType, librevenge::RVNGBinaryData> &img = *imgPtr;
     const ImgType &type = img.first;
-    const librevenge::RVNGBinaryData *data = &img.second;
-    // fix broken MSPUB DIB by putting in correct fg and bg colors
-    librevenge::RVNGBinaryData fixedImg;
-    if (type == DIB && data->size() >= 0x36 + 8)
+    const librevenge::RVNGBinaryData &data = img.second;
+    out->insert("librevenge:mime-type", mimeByImgType(type));
+    if (type == DIB && data.size() >= 0x36 + 8)
     {
-      fixedImg.append(data->getDataBuffer(), 0x36);
-      fixedImg.append(fgColor.b);
-      fixedImg.append(fgColor.g);
-      fixedImg.append(fgColor.r);
-      fixedImg.append(static_cast<unsigned char>('\0'));
-      fixedImg.append(bgColor.b);
-      fixedImg.append(bgColor.g);
-      fixedImg.append(bgColor.r);
-      fixedImg.append(static_cast<unsigned char>('\0'));
-      fixedImg.append(data->getDataBuffer() + 0x36 + 8, data->size() - 0x36 - 8);
-      data = &fixedImg;
+      const auto key = std::make_tuple(m_imgIndex, MSPUBCollector::getColorKey(fgColor), MSPUBCollector::getColorKey(bgColor));
+      auto it = m_owner->m_recoloredImagesBase64.find(key);
+      if (it == m_owner->m_recoloredImagesBase64.end())
+      {
+        // fix broken MSPUB DIB by putting in correct fg and bg colors
+        librevenge::RVNGBinaryData fixedImg;
+        fixedImg.append(data.getDataBuffer(), 0x36);
+        fixedImg.append(fgColor.b);
+        fixedImg.append(fgColor.g);
+        fixedImg.append(fgColor.r);
+        fixedImg.append(static_cast<unsigned char>('\0'));
+        fixedImg.append(bgColor.b);
+        fixedImg.append(bgColor.g);
+        fixedImg.append(bgColor.r);
+        fixedImg.append(static_cast<unsigned char>('\0'));
+        fixedImg.append(data.getDataBuffer() + 0x36 + 8, data.size() - 0x36 - 8);
+        it = m_owner->m_recoloredImagesBase64.insert(std::make_pair(key, fixedImg.getBase64Data())).first;
+      }
+      out->insert("draw:fill-image", it->second);
     }
-    out->insert("librevenge:mime-type", mimeByImgType(type));
-    out->insert("draw:fill-image", data->getBase64Data());
+    else
+      out->insert("draw:fill-image", m_owner->getImageBase64(m_imgIndex));
     out->insert("draw:fill-image-ref-point", "top-left");
   }
 }
@@ -97,9 +107,8 @@ Pattern88Fill::Pattern88Fill(const MSPUBCollector *owner, uint8_t const(&data)[8
 void Pattern88Fill::getProperties(librevenge::RVNGPropertyList *out) const
 {
   out->insert("draw:fill", "bitmap");
-  librevenge::RVNGBinaryData data=createPNGForSimplePattern(m_data, m_col0.getFinalColor(m_owner->m_paletteColors), m_col1.getFinalColor(m_owner->m_paletteColors));
   out->insert("librevenge:mime-type", mimeByImgType(PNG));
-  out->insert("draw:fill-image", data.getBase64Data());
+  out->insert("draw:fill-image", m_owner->getPatternPNGBase64(m_data, m_col0.getFinalColor(m_owner->m_paletteColors), m_col1.getFinalColor(m_owner->m_paletteColors)));
   out->insert("draw:fill-image-ref-point", "top-left");
 }
 
@@ -0,0 +1,106 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_FLATMAP_H
+#define INCLUDED_FLATMAP_H
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace libmspub
+{
+
+/** A small map stored as a vector sorted by key.
+
+    It has the subset of the std::map interface used with getIfExists,
+    and is meant for the few dozen properties of an Escher record.
+  */
+template <typename K, typename V>
+class FlatMap
+{
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K, V> value_type;
+  typedef typename std::vector<value_type>::iterator iterator;
+  typedef typename std::vector<value_type>::const_iterator const_iterator;
+
+  FlatMap() : m_values() { }
+
+  iterator begin()
+  {
+    return m_values.begin();
+  }
+  iterator end()
+  {
+    return m_values.end();
+  }
+  const_iterator begin() const
+  {
+    return m_values.begin();
+  }
+  const_iterator end() const
+  {
+    return m_values.end();
+  }
+  bool empty() const
+  {
+    return m_values.empty();
+  }
+  std::size_t size() const
+  {
+    return m_values.size();
+  }
+  void reserve(std::size_t n)
+  {
+    m_values.reserve(n);
+  }
+  void clear()
+  {
+    m_values.clear();
+  }
+
+  iterator find(const K &key)
+  {
+    const iterator it = lowerBound(m_values.begin(), m_values.end(), key);
+    return (it != m_values.end() && it->first == key) ? it : m_values.end();
+  }
+  const_iterator find(const K &key) const
+  {
+    const const_iterator it = lowerBound(m_values.begin(), m_values.end(), key);
+    return (it != m_values.end() && it->first == key) ? it : m_values.end();
+  }
+  //! Returns the value of key, inserting a default one if needed.
+  V &operator[](const K &key)
+  {
+    iterator it = lowerBound(m_values.begin(), m_values.end(), key);
+    if (it == m_values.end() || it->first != key)
+      it = m_values.insert(it, value_type(key, V()));
+    return it->second;
+  }
+
+private:
+  static bool keyLess(const value_type &value, const K &key)
+  {
+    return value.first < key;
+  }
+  template <typename It>
+  static It lowerBound(It first, It last, const K &key)
+  {
+    return std::lower_bound(first, last, key, keyLess);
+  }
+
+  std::vector<value_type> m_values;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_FLATMAP_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,256 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "GuideEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "PolygonUtils.h"
+#include "libmspub_utils.h"
+
+namespace libmspub
+{
+
+namespace
+{
+
+enum GuideState
+{
+  GUIDE_NOT_SEEN,
+  GUIDE_IN_PROGRESS,
+  GUIDE_DONE
+};
+
+struct GuideContext
+{
+  GuideContext(const CustomShape &shape, const std::vector<int> &adjustValues, double aspectRatio, std::vector<double> &values)
+    : m_shape(shape)
+    , m_adjustValues(adjustValues)
+    , m_aspectRatio(aspectRatio)
+    , m_values(values)
+    , m_states(shape.m_numCalculations, GUIDE_NOT_SEEN)
+  {
+  }
+
+  const CustomShape &m_shape;
+  const std::vector<int> &m_adjustValues;
+  double m_aspectRatio;
+  std::vector<double> &m_values;
+  std::vector<unsigned char> m_states;
+};
+
+int getArgument(const Calculation &c, unsigned which)
+{
+  return which == 0 ? c.m_argOne : which == 1 ? c.m_argTwo : c.m_argThree;
+}
+
+bool isSpecialArgument(const Calculation &c, unsigned which)
+{
+  return (c.m_flags & (0x2000 << which)) != 0;
+}
+
+//! Returns true if the special argument arg is the value of another guide
+bool getReferencedGuide(int arg, unsigned &index)
+{
+  if ((PROP_ADJUST_VAL_FIRST <= arg && PROP_ADJUST_VAL_LAST >= arg) || arg == ASPECT_RATIO || !(arg & OTHER_CALC_VAL))
+    return false;
+  index = unsigned(arg & 0xff);
+  return true;
+}
+
+double getSpecialValue(const GuideContext &context, int arg)
+{
+  if (PROP_ADJUST_VAL_FIRST <= arg && PROP_ADJUST_VAL_LAST >= arg)
+  {
+    unsigned adjustIndex = unsigned(arg - PROP_ADJUST_VAL_FIRST);
+    if (adjustIndex < context.m_adjustValues.size())
+    {
+      if ((context.m_shape.m_adjustShiftMask >> adjustIndex) & 0x1)
+      {
+        return context.m_adjustValues[adjustIndex] >> 16;
+      }
+      return context.m_adjustValues[adjustIndex];
+    }
+    return 0;
+  }
+  if (arg == ASPECT_RATIO)
+    return context.m_aspectRatio;
+  unsigned index;
+  if (getReferencedGuide(arg, index))
+  {
+    // a guide which is not done yet is part of a cycle: ban recursion entirely
+    if (index < context.m_states.size() && context.m_states[index] == GUIDE_DONE)
+      return context.m_values[index];
+    return 0;
+  }
+  switch (arg)
+  {
+  case PROP_GEO_LEFT:
+    return 0;
+  case PROP_GEO_TOP:
+    return 0;
+  case PROP_GEO_RIGHT:
+    return context.m_shape.m_coordWidth;
+  case PROP_GEO_BOTTOM:
+    return context.m_shape.m_coordHeight;
+  default:
+    break;
+  }
+  return 0;
+}
+
+double evaluate(const GuideContext &context, unsigned index)
+{
+  const Calculation &c = context.m_shape.mp_calculations[index];
+  double valOne = isSpecialArgument(c, 0) ? getSpecialValue(context, c.m_argOne) : c.m_argOne;
+  double valTwo = isSpecialArgument(c, 1) ? getSpecialValue(context, c.m_argTwo) : c.m_argTwo;
+  double valThree = isSpecialArgument(c, 2) ? getSpecialValue(context, c.m_argThree) : c.m_argThree;
+  switch (c.m_flags & 0xFF)
+  {
+  case 0:
+  case 14:
+    return valOne + valTwo - valThree;
+  case 1:
+    return valOne * valTwo / ((valThree <= 0 && valThree >= 0) ? 1 : valThree);
+  case 2:
+    return (valOne + valTwo) / 2;
+  case 3:
+    return fabs(valOne);
+  case 4:
+    return std::min(valOne, valTwo);
+  case 5:
+    return std::max(valOne, valTwo);
+  case 6:
+    return (valOne<0 || valOne>0) ? valTwo : valThree;
+  case 7:
+    return sqrt(valOne * valTwo * valThree);
+  case 8:
+    return atan2(valTwo, valOne) / (M_PI / 180);
+  case 9:
+    return valOne * sin(valTwo * (M_PI / 180));
+  case 10:
+    return valOne * cos(valTwo * (M_PI / 180));
+  case 11:
+    return valOne * cos(atan2(valThree, valTwo));
+  case 12:
+    return valOne * sin(atan2(valThree, valTwo));
+  case 13:
+    return sqrt(valOne);
+  case 15:
+    return valThree * sqrt(1 - (valOne / valTwo) * (valOne / valTwo));
+  case 16:
+    return valOne * tan(valTwo);
+  case 0x80:
+    return sqrt(valThree * valThree - valOne * valOne);
+  case 0x81:
+    return (cos(valThree * (M_PI / 180)) * (valOne - 10800) + sin(valThree * (M_PI / 180)) * (valTwo - 10800)) + 10800;
+  case 0x82:
+    return -(sin(valThree * (M_PI / 180)) * (valOne - 10800) - cos(valThree * (M_PI / 180)) * (valTwo - 10800)) + 10800;
+  default:
+    return 0;
+  }
+}
+
+} // anonymous namespace
+
+bool GuideEvaluator::usesAspectRatio(const CustomShape *shape)
+{
+  if (!shape || !shape->mp_calculations)
+    return false;
+  for (unsigned i = 0; i < shape->m_numCalculations; ++i)
+  {
+    const Calculation &c = shape->mp_calculations[i];
+    for (unsigned which = 0; which < 3; ++which)
+    {
+      if (isSpecialArgument(c, which) && getArgument(c, which) == ASPECT_RATIO)
+        return true;
+    }
+  }
+  return false;
+}
+
+GuideEvaluator::GuideEvaluator(const CustomShape *shape, const std::vector<int> &adjustValues, double aspectRatio)
+  : m_values()
+{
+  if (shape)
+    evaluateAll(*shape, getEvaluationOrder(shape), adjustValues, aspectRatio);
+}
+
+GuideEvaluator::GuideEvaluator(const CustomShape *shape, const std::vector<unsigned> &order, const std::vector<int> &adjustValues, double aspectRatio)
+  : m_values()
+{
+  if (shape)
+    evaluateAll(*shape, order, adjustValues, aspectRatio);
+}
+
+void GuideEvaluator::evaluateAll(const CustomShape &shape, const std::vector<unsigned> &order, const std::vector<int> &adjustValues, double aspectRatio)
+{
+  if (!shape.mp_calculations)
+    return;
+  m_values.resize(shape.m_numCalculations, 0);
+  GuideContext context(shape, adjustValues, aspectRatio, m_values);
+  for (auto it = order.begin(); it != order.end(); ++it)
+  {
+    if (*it >= shape.m_numCalculations)
+      continue;
+    m_values[*it] = evaluate(context, *it);
+    context.m_states[*it] = GUIDE_DONE;
+  }
+}
+
+std::vector<unsigned> GuideEvaluator::getEvaluationOrder(const CustomShape *shape)
+{
+  std::vector<unsigned> order;
+  if (!shape || !shape->mp_calculations)
+    return order;
+  const unsigned numGuides = shape->m_numCalculations;
+  order.reserve(numGuides);
+  std::vector<unsigned char> states(numGuides, GUIDE_NOT_SEEN);
+
+  // depth-first walk of the references: a guide comes after all the guides
+  // it uses, i.e. in topological order
+  std::vector<std::pair<unsigned, unsigned> > stack; // guide, next argument to look at
+  for (unsigned root = 0; root < numGuides; ++root)
+  {
+    if (states[root] != GUIDE_NOT_SEEN)
+      continue;
+    states[root] = GUIDE_IN_PROGRESS;
+    stack.push_back(std::make_pair(root, 0u));
+    while (!stack.empty())
+    {
+      const unsigned index = stack.back().first;
+      const Calculation &c = shape->mp_calculations[index];
+      bool pushed = false;
+      while (!pushed && stack.back().second < 3)
+      {
+        const unsigned which = stack.back().second++;
+        unsigned referenced;
+        if (isSpecialArgument(c, which) && getReferencedGuide(getArgument(c, which), referenced)
+            && referenced < numGuides && states[referenced] == GUIDE_NOT_SEEN)
+        {
+          states[referenced] = GUIDE_IN_PROGRESS;
+          stack.push_back(std::make_pair(referenced, 0u));
+          pushed = true;
+        }
+      }
+      if (pushed)
+        continue;
+      order.push_back(index);
+      states[index] = GUIDE_DONE;
+      stack.pop_back();
+    }
+  }
+  return order;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,57 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_GUIDEEVALUATOR_H
+#define INCLUDED_GUIDEEVALUATOR_H
+
+#include <vector>
+
+namespace libmspub
+{
+
+struct CustomShape;
+
+/** The values of the guides (the calculations) of a custom shape.
+
+    All the guides are evaluated once, when the evaluator is created: each
+    guide is computed after the guides it refers to. As before, a reference
+    which would close a cycle evaluates to 0.
+  */
+class GuideEvaluator
+{
+public:
+  GuideEvaluator(const CustomShape *shape, const std::vector<int> &adjustValues, double aspectRatio);
+  //! Evaluates the guides in order, as returned by getEvaluationOrder
+  GuideEvaluator(const CustomShape *shape, const std::vector<unsigned> &order, const std::vector<int> &adjustValues, double aspectRatio);
+
+  double getValue(unsigned index) const
+  {
+    return index < m_values.size() ? m_values[index] : 0;
+  }
+  //! Allows to use the evaluator as the calculator of resolveVertices
+  double operator()(unsigned index) const
+  {
+    return getValue(index);
+  }
+
+  //! Returns true if the guides of shape depend on the aspect ratio of the shape
+  static bool usesAspectRatio(const CustomShape *shape);
+  //! Returns the guides of shape, each one after the guides it refers to
+  static std::vector<unsigned> getEvaluationOrder(const CustomShape *shape);
+
+private:
+  void evaluateAll(const CustomShape &shape, const std::vector<unsigned> &order, const std::vector<int> &adjustValues, double aspectRatio);
+
+  std::vector<double> m_values;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_GUIDEEVALUATOR_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
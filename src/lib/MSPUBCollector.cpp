@@ -12,11 +12,14 @@
 #include <string.h>
 
 #include <algorithm>
+#include <cstdlib>
 #include <functional>
+#include <limits>
 #include <math.h>
 #include <memory>
 #include <numeric>
 #include <string>
+#include <type_traits>
 
 #include <boost/multi_array.hpp>
 
@@ -27,6 +30,7 @@
 #include "Coordinate.h"
 #include "Dash.h"
 #include "Fill.h"
+#include "GuideEvaluator.h"
 #include "Line.h"
 #include "Margins.h"
 #include "MSPUBConstants.h"
@@ -224,7 +228,8 @@ void mapTableTextToCells(
 
     for (unsigned i_spans = 0; i_spans != text[para].spans.size(); ++i_spans)
     {
-      auto textString=text[para].spans[i_spans].chars;
+      const TextSpan &span=text[para].spans[i_spans];
+      std::vector<unsigned char> textString(span.data(), span.data()+span.size());
       offset += unsigned(textString.size());
       // TODO: why do we not drop these during parse already?
       if (i_spans == text[para].spans.size() - 1)
@@ -333,6 +338,141 @@ void fillLocale(librevenge::RVNGPropertyList &props, const unsigned lcid)
     props.insert("fo:script", component);
 }
 
+/** The key of a style in the style caches: the values its properties
+    depend on, byte by byte.
+  */
+class StyleKey
+{
+public:
+  StyleKey()
+    : m_key()
+  {
+  }
+  template <typename T> void add(const T &value)
+  {
+    static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "only plain values have no padding");
+    m_key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+  template <typename T> void add(const boost::optional<T> &value)
+  {
+    add(bool(value));
+    if (value)
+      add(*value);
+  }
+  const std::string &get() const
+  {
+    return m_key;
+  }
+
+private:
+  std::string m_key;
+};
+
+std::string getStyleKey(const CharacterStyle &style, unsigned defaultCharStyleIndex, const boost::optional<double> &paraLetterSpacing)
+{
+  StyleKey key;
+  key.add(defaultCharStyleIndex);
+  key.add(paraLetterSpacing);
+  key.add(style.underline);
+  key.add(style.italic);
+  key.add(style.bold);
+  key.add(style.textSizeInPt);
+  key.add(style.colorIndex);
+  key.add(style.fontIndex);
+  key.add(style.superSubType);
+  key.add(style.outline);
+  key.add(style.shadow);
+  key.add(style.smallCaps);
+  key.add(style.allCaps);
+  key.add(style.emboss);
+  key.add(style.engrave);
+  key.add(style.textScale);
+  key.add(style.letterSpacingInPt);
+  key.add(style.lcid);
+  return key.get();
+}
+
+std::string getStyleKey(const ParagraphStyle &style, boost::optional<unsigned> defaultParaStyleIndex)
+{
+  StyleKey key;
+  key.add(defaultParaStyleIndex);
+  key.add(style.m_align);
+  key.add(bool(style.m_lineSpacing));
+  if (style.m_lineSpacing)
+  {
+    key.add(style.m_lineSpacing->m_type);
+    key.add(style.m_lineSpacing->m_amount);
+  }
+  key.add(style.m_spaceBeforeEmu);
+  key.add(style.m_spaceAfterEmu);
+  key.add(style.m_firstLineIndentEmu);
+  key.add(style.m_leftIndentEmu);
+  key.add(style.m_rightIndentEmu);
+  key.add(bool(style.m_listInfo));
+  key.add(style.m_tabStops.size());
+  for (const auto &tab : style.m_tabStops)
+  {
+    key.add(tab.m_positionInEmu);
+    key.add(tab.m_alignment);
+    key.add(tab.m_decimalChar);
+    key.add(tab.m_leaderChar);
+  }
+  return key.get();
+}
+
+//! the size of the pieces of text the charset detection looks at
+const std::size_t CHARSET_SAMPLE_SLICE = 4096;
+//! the most pieces of text the charset detection looks at
+const unsigned CHARSET_SAMPLE_MAX_SLICES = 16;
+//! the change of confidence under which two detections agree
+const int32_t CHARSET_CONFIDENCE_MARGIN = 10;
+
+//! Fills sample with numSlices (at least 2) pieces of text, spread evenly over it
+void getCharsetSample(const unsigned char *text, std::size_t size, unsigned numSlices, std::vector<unsigned char> &sample)
+{
+  sample.clear();
+  if (size <= numSlices * CHARSET_SAMPLE_SLICE)
+  {
+    sample.assign(text, text + size);
+    return;
+  }
+  sample.reserve(numSlices * CHARSET_SAMPLE_SLICE);
+  const std::size_t step = (size - CHARSET_SAMPLE_SLICE) / (numSlices - 1);
+  for (unsigned i = 0; i < numSlices; ++i)
+  {
+    const unsigned char *const begin = text + i * step;
+    sample.insert(sample.end(), begin, begin + CHARSET_SAMPLE_SLICE);
+  }
+}
+
+//! Returns the most likely charset of text that is a Windows one, or nullptr
+const char *detectWindowsCharset(UCharsetDetector *ucd, const std::vector<unsigned char> &text, int32_t &confidence)
+{
+  UErrorCode status = U_ZERO_ERROR;
+  // don't worry, the below call doesn't require a null-terminated string.
+  ucsdet_setText(ucd, reinterpret_cast<const char *>(text.data()), int32_t(text.size()), &status);
+  if (U_FAILURE(status))
+    return nullptr;
+  int32_t matchesFound = 0;
+  const UCharsetMatch **matches = ucsdet_detectAll(ucd, &matchesFound, &status);
+  if (U_FAILURE(status))
+    return nullptr;
+  //find best fit that is an actual Windows encoding
+  for (int32_t i = 0; i < matchesFound; ++i)
+  {
+    const char *name = ucsdet_getName(matches[i], &status);
+    if (U_FAILURE(status))
+      return nullptr;
+    const char *windowsName = windowsCharsetNameByOriginalCharset(name);
+    if (windowsName)
+    {
+      confidence = ucsdet_getConfidence(matches[i], &status);
+      return windowsName;
+    }
+  }
+  return nullptr;
+}
+
 } // anonymous namespace
 
 void MSPUBCollector::collectMetaData(const librevenge::RVNGPropertyList &metaData)
@@ -468,6 +608,12 @@ void MSPUBCollector::setNextPage(unsigned pageSeqNum)
   m_pageSeqNumsOrdered.push_back(pageSeqNum);
 }
 
+void MSPUBCollector::setPageRange(unsigned firstPage, unsigned lastPage)
+{
+  m_firstPage = std::max(firstPage, 1u);
+  m_lastPage = lastPage;
+}
+
 MSPUBCollector::MSPUBCollector(librevenge::RVNGDrawingInterface *painter)
   : m_painter(painter)
   , m_contentChunkReferences()
@@ -479,35 +625,41 @@ MSPUBCollector::MSPUBCollector(librevenge::RVNGDrawingInterface *painter)
   , m_textStringsById()
   , m_pagesBySeqNum()
   , m_images()
+  , m_delayedImages()
+  , m_imagesBase64()
+  , m_recoloredImagesBase64()
+  , m_OLEPreviewsBase64()
+  , m_patternPNGsBase64()
+  , m_builtInShapeVertices()
   , m_borderImages()
   , m_OLEs()
   , m_textColors()
   , m_fonts()
   , m_defaultCharStyles()
   , m_defaultParaStyles()
-  , m_shapeTypesBySeqNum()
   , m_paletteColors()
   , m_shapeSeqNumsOrdered()
-  , m_pageSeqNumsByShapeSeqNum()
   , m_bgShapeSeqNumsByPageSeqNum()
   , m_skipIfNotBgSeqNums()
   , m_currentShapeGroup()
   , m_topLevelShapes()
-  , m_groupsBySeqNum()
   , m_embeddedFonts()
   , m_shapeInfosBySeqNum()
   , m_masterPages()
-  , m_shapesWithCoordinatesRotated90()
   , m_masterPagesByPageSeqNum()
   , m_tableCellTextEndsByTextId()
   , m_stringOffsetsByTextId()
   , m_tableCellStylesByTextId()
-  , m_calculationValuesSeen()
   , m_pageSeqNumsOrdered()
+  , m_firstPage(1)
+  , m_lastPage(std::numeric_limits<unsigned>::max())
   , m_encodingHeuristic(false)
-  , m_allText()
+  , m_textArena()
   , m_calculatedEncoding()
   , m_fontsEncoding()
+  , m_converters()
+  , m_charStyleProps()
+  , m_paraStyleProps()
   , m_metaData()
   , m_idToPageMasterNameMap()
 {
@@ -552,11 +704,6 @@ void noop(const CustomShape *)
 {
 }
 
-void MSPUBCollector::setShapeCoordinatesRotated90(unsigned seqNum)
-{
-  m_shapesWithCoordinatesRotated90.insert(seqNum);
-}
-
 void MSPUBCollector::setShapeBorderImageId(unsigned seqNum, unsigned id)
 {
   m_shapeInfosBySeqNum[seqNum].m_borderImgIndex = id;
@@ -565,7 +712,7 @@ void MSPUBCollector::setShapeBorderImageId(unsigned seqNum, unsigned id)
 void MSPUBCollector::setShapeCustomPath(unsigned seqNum,
                                         const DynamicCustomShape &shape)
 {
-  m_shapeInfosBySeqNum[seqNum].m_customShape = shape;
+  m_shapeInfosBySeqNum[seqNum].m_customShape = std::make_shared<const DynamicCustomShape>(shape);
 }
 
 void MSPUBCollector::setShapeClipPath(unsigned seqNum, const std::vector<Vertex> &clip)
@@ -625,7 +772,6 @@ bool MSPUBCollector::setCurrentGroupSeqNum(unsigned seqNum)
     return false;
   }
   m_currentShapeGroup->setSeqNum(seqNum);
-  m_groupsBySeqNum.insert(std::make_pair(seqNum, m_currentShapeGroup));
   return true;
 }
 
@@ -676,23 +822,19 @@ std::vector<int> MSPUBCollector::getShapeAdjustValues(const ShapeInfo &info) con
   return ret;
 }
 
-boost::optional<std::vector<TextParagraph> > MSPUBCollector::getShapeText(const ShapeInfo &info) const
+const std::vector<TextParagraph> *MSPUBCollector::getShapeText(const ShapeInfo &info) const
 {
   if (bool(info.m_textId))
   {
     unsigned stringId = info.m_textId.get();
-    const std::vector<TextParagraph> *ptr_str = getIfExists_const(m_textStringsById, stringId);
-    if (ptr_str)
-    {
-      return *ptr_str;
-    }
+    return getIfExists_const(m_textStringsById, stringId);
   }
-  return boost::optional<std::vector<TextParagraph> >();
+  return nullptr;
 }
 
 void MSPUBCollector::setupShapeStructures(ShapeGroupElement &elt)
 {
-  ShapeInfo *ptr_info = getIfExists(m_shapeInfosBySeqNum, elt.getSeqNum());
+  ShapeInfo *ptr_info = m_shapeInfosBySeqNum.find(elt.getSeqNum());
   if (ptr_info)
   {
     if (bool(ptr_info->m_imgIndex))
@@ -706,6 +848,7 @@ void MSPUBCollector::setupShapeStructures(ShapeGroupElement &elt)
         ptr_info->m_fill = std::shared_ptr<const Fill>(new ImgFill(index, this, false, rot));
       }
     }
+    ptr_info->resolveCustomShape();
     elt.setShapeInfo(*ptr_info);
     std::pair<bool, bool> flips = ptr_info->m_flips.get_value_or(std::pair<bool, bool>(false, false));
     VectorTransformation2D flipsTransform = VectorTransformation2D::fromFlips(flips.second, flips.first);
@@ -726,6 +869,11 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
     m_painter->startLayer(librevenge::RVNGPropertyList());
     return std::bind(&endShapeGroup, m_painter);
   }
+  const std::shared_ptr<const CustomShape> customShape = info.getCustomShape();
+  const Coordinate shapeCoord = info.m_coordinates.get_value_or(Coordinate());
+  const double aspectRatio = (shapeCoord.getHeightIn() < 0 || shapeCoord.getHeightIn() > 0) ? double(shapeCoord.getWidthIn()) / shapeCoord.getHeightIn() : 0;
+  // only resolved if the shape is drawn
+  std::shared_ptr<const std::vector<Vector2D> > vertices;
   librevenge::RVNGPropertyList graphicsProps;
   bool isOLE=info.m_OLEIndex && m_OLEs.find(*info.m_OLEIndex)!=m_OLEs.end();
   if (isOLE && !foldedTransform.isSimple())
@@ -733,7 +881,7 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
     auto const &obj=m_OLEs.find(*info.m_OLEIndex)->second;
     graphicsProps.insert("draw:fill", "bitmap");
     graphicsProps.insert("librevenge:mime-type", !obj.m_typeList.empty() ? obj.m_typeList[0].c_str() : "image/pict");
-    graphicsProps.insert("draw:fill-image", obj.m_dataList[0].getBase64Data());
+    graphicsProps.insert("draw:fill-image", getOLEPreviewBase64(*info.m_OLEIndex));
     graphicsProps.insert("draw:fill-image-ref-point", "top-left");
 
     isOLE=false;
@@ -788,7 +936,7 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
   }
   librevenge::RVNGString fill = graphicsProps["draw:fill"] ? graphicsProps["draw:fill"]->getStr() : "none";
   bool hasFill = fill != "none";
-  boost::optional<std::vector<TextParagraph> > maybeText = getShapeText(info);
+  const std::vector<TextParagraph> *maybeText = getShapeText(info);
   auto hasText = bool(maybeText);
   const auto isTable = bool(info.m_tableInfo);
   bool makeLayer = hasBorderArt ||
@@ -803,7 +951,7 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       y = coord.getYIn(m_height);
       height = coord.getHeightIn();
       width = coord.getWidthIn();
-      m_painter->startLayer(calcClipPath(info.m_clipPath, x, y, height, width, foldedTransform, info.getCustomShape()));
+      m_painter->startLayer(calcClipPath(info.m_clipPath, x, y, height, width, foldedTransform, customShape));
     }
     else
       m_painter->startLayer(librevenge::RVNGPropertyList());
@@ -889,9 +1037,11 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       }
       m_painter->setStyle(graphicsProps);
 
+      if (!vertices)
+        vertices = getShapeVertices(info, customShape, adjustValues, aspectRatio);
       writeCustomShape(type, graphicsProps, m_painter, x, y, height, width,
                        true, foldedTransform,
-                       std::vector<Line>(), std::bind(&MSPUBCollector::getCalculationValue, this, info, _1, false, adjustValues), m_paletteColors, info.getCustomShape());
+                       std::vector<Line>(), *vertices, m_paletteColors, customShape);
       if (bool(info.m_pictureRecolor))
       {
         graphicsProps.remove("draw:color-mode");
@@ -961,17 +1111,16 @@ std::function<void(void)> MSPUBCollector::paintShape(const ShapeInfo &info, cons
       {
         graphicsProps.insert("draw:stroke", "solid");
       }
+      if (!vertices)
+        vertices = getShapeVertices(info, customShape, adjustValues, aspectRatio);
       writeCustomShape(type, graphicsProps, m_painter, x, y, height, width,
                        false, foldedTransform, lines,
-                       std::bind(
-                         &MSPUBCollector::getCalculationValue, this, info, _1, false, adjustValues
-                       ),
-                       m_paletteColors, info.getCustomShape());
+                       *vertices, m_paletteColors, customShape);
     }
   }
   if (hasText)
   {
-    const std::vector<TextParagraph> &text = maybeText.get();
+    const std::vector<TextParagraph> &text = *maybeText;
     graphicsProps.insert("draw:fill", "none");
     Coordinate textCoord = isShapeTypeRectangle(type) ?
                            getFudgedCoordinates(coord, lines, false, borderPosition) : coord;
@@ -1043,9 +1192,7 @@ void MSPUBCollector::paintTextObject(const ShapeInfo &info, std::vector<TextPara
     bool hasDropStyle= paraStyle.m_dropCapStyle && !paraStyle.m_dropCapStyle->empty();
     for (size_t i_spans = 0; i_spans < line.spans.size(); ++i_spans)
     {
-      librevenge::RVNGPropertyList charProps = getCharStyleProps(line.spans[i_spans].style, paraStyle.m_defaultCharStyleIndex);
-      if (paraLetterSpacing && !charProps["fo:letter-spacing"])
-        charProps.insert("fo:letter-spacing", get(paraLetterSpacing), librevenge::RVNG_POINT);
+      const librevenge::RVNGPropertyList &charProps = getCharStyleProps(line.spans[i_spans].style, paraStyle.m_defaultCharStyleIndex, paraLetterSpacing);
 
       if (line.spans[i_spans].field)
       {
@@ -1058,8 +1205,8 @@ void MSPUBCollector::paintTextObject(const ShapeInfo &info, std::vector<TextPara
       }
 
       librevenge::RVNGString textString;
-      if (!line.spans[i_spans].chars.empty())
-        appendCharacters(textString, line.spans[i_spans].chars, getCalculatedEncoding(line.spans[i_spans].style.fontIndex));
+      if (!line.spans[i_spans].empty())
+        appendCharacters(textString, line.spans[i_spans].data(), line.spans[i_spans].size(), getCalculatedEncoding(line.spans[i_spans].style.fontIndex), &m_converters);
       if (i_spans==0 && hasDropStyle)
         textString=paintDropCap(textString, charProps,*paraStyle.m_dropCapStyle);
       m_painter->openSpan(charProps);
@@ -1144,9 +1291,7 @@ void MSPUBCollector::paintTable(const ShapeInfo &info, std::vector<TextParagraph
 
             for (size_t i_spans = 0; i_spans < paraTexts[para].size(); ++i_spans)
             {
-              librevenge::RVNGPropertyList charProps = getCharStyleProps(text[para].spans[i_spans].style, paraStyle.m_defaultCharStyleIndex);
-              if (paraLetterSpacing && !charProps["fo:letter-spacing"])
-                charProps.insert("fo:letter-spacing", get(paraLetterSpacing), librevenge::RVNG_POINT);
+              const librevenge::RVNGPropertyList &charProps = getCharStyleProps(text[para].spans[i_spans].style, paraStyle.m_defaultCharStyleIndex, paraLetterSpacing);
               if (text[para].spans[i_spans].field)
               {
                 m_painter->openSpan(charProps);
@@ -1159,7 +1304,7 @@ void MSPUBCollector::paintTable(const ShapeInfo &info, std::vector<TextParagraph
 
               librevenge::RVNGString textString;
               if (!paraTexts[para][i_spans].empty())
-                appendCharacters(textString, paraTexts[para][i_spans], getCalculatedEncoding(text[para].spans[i_spans].style.fontIndex));
+                appendCharacters(textString, paraTexts[para][i_spans], getCalculatedEncoding(text[para].spans[i_spans].style.fontIndex), &m_converters);
               if (i_spans==0 && hasDropStyle)
               {
                 auto normalString=paintDropCap(textString, charProps, *paraStyle.m_dropCapStyle);
@@ -1381,53 +1526,34 @@ const char *MSPUBCollector::getCalculatedEncoding() const
     return m_calculatedEncoding.get();
   }
   // for older versions of PUB, see if we can get ICU to tell us the encoding.
+  // It looks at growing samples of the text, until two of them agree.
+  const char *encoding = nullptr;
   UErrorCode status = U_ZERO_ERROR;
-  UCharsetDetector *ucd = nullptr;
-  const UCharsetMatch **matches = nullptr;
-  const UCharsetMatch *ucm = nullptr;
-  ucd = ucsdet_open(&status);
-  int matchesFound = -1;
-  const char *name = nullptr;
-  const char *windowsName = nullptr;
-  if (m_allText.empty())
-  {
-    goto csd_fail;
-  }
-  if (U_FAILURE(status))
+  UCharsetDetector *ucd = ucsdet_open(&status);
+  if (U_SUCCESS(status) && !m_textArena.empty())
   {
-    goto csd_fail;
-  }
-  // don't worry, the below call doesn't require a null-terminated string.
-  ucsdet_setText(ucd, reinterpret_cast<const char *>(m_allText.data()), int32_t(m_allText.size()), &status);
-  if (U_FAILURE(status))
-  {
-    goto csd_fail;
-  }
-  matches = ucsdet_detectAll(ucd, &matchesFound, &status);
-  if (U_FAILURE(status))
-  {
-    goto csd_fail;
-  }
-  //find best fit that is an actual Windows encoding
-  for (int i = 0; i < matchesFound; ++i)
-  {
-    ucm = matches[i];
-    name = ucsdet_getName(ucm, &status);
-    if (U_FAILURE(status))
+    std::vector<unsigned char> sample;
+    const char *previous = nullptr;
+    int32_t previousConfidence = 0;
+    for (unsigned numSlices = 4; numSlices <= CHARSET_SAMPLE_MAX_SLICES; numSlices *= 2)
     {
-      goto csd_fail;
-    }
-    windowsName = windowsCharsetNameByOriginalCharset(name);
-    if (windowsName)
-    {
-      m_calculatedEncoding = windowsName;
-      ucsdet_close(ucd);
-      return windowsName;
+      getCharsetSample(m_textArena.data(), m_textArena.size(), numSlices, sample);
+      int32_t confidence = 0;
+      encoding = detectWindowsCharset(ucd, sample, confidence);
+      if (sample.size() == m_textArena.size())
+        break;
+      if (encoding && previous && strcmp(encoding, previous) == 0
+          && std::abs(confidence - previousConfidence) <= CHARSET_CONFIDENCE_MARGIN)
+        break;
+      previous = encoding;
+      previousConfidence = confidence;
     }
   }
-csd_fail:
-  ucsdet_close(ucd);
-  return "windows-1252"; // Pretty likely to give garbage text, but it's the best we can do.
+  if (ucd)
+    ucsdet_close(ucd);
+  // windows-1252 is pretty likely to give garbage text, but it's the best we can do.
+  m_calculatedEncoding = encoding ? encoding : "windows-1252";
+  return m_calculatedEncoding.get();
 }
 
 const char *MSPUBCollector::getCalculatedEncoding(boost::optional<unsigned> fontIndex) const
@@ -1540,126 +1666,6 @@ void MSPUBCollector::writeImage(double x, double y,
   m_painter->drawGraphicObject(props);
 }
 
-double MSPUBCollector::getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues) const
-{
-  if (PROP_ADJUST_VAL_FIRST <= arg && PROP_ADJUST_VAL_LAST >= arg)
-  {
-    unsigned adjustIndex = unsigned(arg - PROP_ADJUST_VAL_FIRST);
-    if (adjustIndex < adjustValues.size())
-    {
-      if ((shape.m_adjustShiftMask >> adjustIndex) & 0x1)
-      {
-        return adjustValues[adjustIndex] >> 16;
-      }
-      return adjustValues[adjustIndex];
-    }
-    return 0;
-  }
-  if (arg == ASPECT_RATIO)
-  {
-    const Coordinate coord = info.m_coordinates.get_value_or(Coordinate());
-    return (coord.getHeightIn() < 0 || coord.getHeightIn() > 0) ? double(coord.getWidthIn()) / coord.getHeightIn() : 0;
-  }
-  if (arg & OTHER_CALC_VAL)
-  {
-    return getCalculationValue(info, arg & 0xff, true, adjustValues);
-  }
-  switch (arg)
-  {
-  case PROP_GEO_LEFT:
-    return 0;
-  case PROP_GEO_TOP:
-    return 0;
-  case PROP_GEO_RIGHT:
-    return shape.m_coordWidth;
-  case PROP_GEO_BOTTOM:
-    return shape.m_coordHeight;
-  default:
-    break;
-  }
-  return 0;
-}
-
-double MSPUBCollector::getCalculationValue(const ShapeInfo &info, unsigned index, bool recursiveEntry, const std::vector<int> &adjustValues) const
-{
-  std::shared_ptr<const CustomShape> p_shape = info.getCustomShape();
-  if (! p_shape)
-  {
-    return 0;
-  }
-  const CustomShape &shape = *p_shape;
-  if (index >= shape.m_numCalculations)
-  {
-    return 0;
-  }
-  if (! recursiveEntry)
-  {
-    m_calculationValuesSeen.clear();
-    m_calculationValuesSeen.resize(shape.m_numCalculations);
-  }
-  if (m_calculationValuesSeen[index])
-  {
-    //recursion detected. The simplest way to avoid infinite recursion, at the "cost"
-    // of making custom shape parsing not Turing-complete ;), is to ban recursion entirely.
-    return 0;
-  }
-  m_calculationValuesSeen[index] = true;
-
-  const Calculation &c = shape.mp_calculations[index];
-  bool oneSpecial = (c.m_flags & 0x2000) != 0;
-  bool twoSpecial = (c.m_flags & 0x4000) != 0;
-  bool threeSpecial = (c.m_flags & 0x8000) != 0;
-
-  double valOne = oneSpecial ? getSpecialValue(info, shape, c.m_argOne, adjustValues) : c.m_argOne;
-  double valTwo = twoSpecial ? getSpecialValue(info, shape, c.m_argTwo, adjustValues) : c.m_argTwo;
-  double valThree = threeSpecial ? getSpecialValue(info, shape, c.m_argThree, adjustValues) : c.m_argThree;
-  m_calculationValuesSeen[index] = false;
-  switch (c.m_flags & 0xFF)
-  {
-  case 0:
-  case 14:
-    return valOne + valTwo - valThree;
-  case 1:
-    return valOne * valTwo / ((valThree <= 0 && valThree >= 0) ? 1 : valThree);
-  case 2:
-    return (valOne + valTwo) / 2;
-  case 3:
-    return fabs(valOne);
-  case 4:
-    return std::min(valOne, valTwo);
-  case 5:
-    return std::max(valOne, valTwo);
-  case 6:
-    return (valOne<0 || valOne>0) ? valTwo : valThree;
-  case 7:
-    return sqrt(valOne * valTwo * valThree);
-  case 8:
-    return atan2(valTwo, valOne) / (M_PI / 180);
-  case 9:
-    return valOne * sin(valTwo * (M_PI / 180));
-  case 10:
-    return valOne * cos(valTwo * (M_PI / 180));
-  case 11:
-    return valOne * cos(atan2(valThree, valTwo));
-  case 12:
-    return valOne * sin(atan2(valThree, valTwo));
-  case 13:
-    return sqrt(valOne);
-  case 15:
-    return valThree * sqrt(1 - (valOne / valTwo) * (valOne / valTwo));
-  case 16:
-    return valOne * tan(valTwo);
-  case 0x80:
-    return sqrt(valThree * valThree - valOne * valOne);
-  case 0x81:
-    return (cos(valThree * (M_PI / 180)) * (valOne - 10800) + sin(valThree * (M_PI / 180)) * (valTwo - 10800)) + 10800;
-  case 0x82:
-    return -(sin(valThree * (M_PI / 180)) * (valOne - 10800) - cos(valThree * (M_PI / 180)) * (valTwo - 10800)) + 10800;
-  default:
-    return 0;
-  }
-}
-
 MSPUBCollector::~MSPUBCollector()
 {
 }
@@ -1746,7 +1752,16 @@ void MSPUBCollector::addFont(std::vector<unsigned char> name)
   m_fonts.push_back(name);
 }
 
-librevenge::RVNGPropertyList MSPUBCollector::getParaStyleProps(const ParagraphStyle &style, boost::optional<unsigned> defaultParaStyleIndex) const
+const librevenge::RVNGPropertyList &MSPUBCollector::getParaStyleProps(const ParagraphStyle &style, boost::optional<unsigned> defaultParaStyleIndex) const
+{
+  const std::string key = getStyleKey(style, defaultParaStyleIndex);
+  auto it = m_paraStyleProps.find(key);
+  if (it == m_paraStyleProps.end())
+    it = m_paraStyleProps.insert(std::make_pair(key, buildParaStyleProps(style, defaultParaStyleIndex))).first;
+  return it->second;
+}
+
+librevenge::RVNGPropertyList MSPUBCollector::buildParaStyleProps(const ParagraphStyle &style, boost::optional<unsigned> defaultParaStyleIndex) const
 {
   ParagraphStyle _nothing;
   const ParagraphStyle &defaultStyle = bool(defaultParaStyleIndex) && defaultParaStyleIndex.get() < m_defaultParaStyles.size() ? m_defaultParaStyles[defaultParaStyleIndex.get()] : _nothing;
@@ -1858,7 +1873,7 @@ librevenge::RVNGPropertyList MSPUBCollector::getParaStyleProps(const ParagraphSt
           librevenge::RVNGString oDecimal;
           std::vector<unsigned char> fDecimal;
           fDecimal.push_back(*tab.m_decimalChar);
-          appendCharacters(oDecimal, fDecimal, getCalculatedEncoding());
+          appendCharacters(oDecimal, fDecimal, getCalculatedEncoding(), &m_converters);
           retTab.insert("style:char", oDecimal);
         }
         else
@@ -1876,7 +1891,7 @@ librevenge::RVNGPropertyList MSPUBCollector::getParaStyleProps(const ParagraphSt
         librevenge::RVNGString oLeader;
         std::vector<unsigned char> fLeader;
         fLeader.push_back(*tab.m_leaderChar);
-        appendCharacters(oLeader, fLeader, getCalculatedEncoding());
+        appendCharacters(oLeader, fLeader, getCalculatedEncoding(), &m_converters);
         retTab.insert("style:leader-text", oLeader);
         retTab.insert("style:leader-style", "solid");
       }
@@ -1887,7 +1902,21 @@ librevenge::RVNGPropertyList MSPUBCollector::getParaStyleProps(const ParagraphSt
   return ret;
 }
 
-librevenge::RVNGPropertyList MSPUBCollector::getCharStyleProps(const CharacterStyle &style, boost::optional<unsigned> defaultCharStyleIndex) const
+const librevenge::RVNGPropertyList &MSPUBCollector::getCharStyleProps(const CharacterStyle &style, boost::optional<unsigned> defaultCharStyleIndex, const boost::optional<double> &paraLetterSpacing) const
+{
+  const std::string key = getStyleKey(style, defaultCharStyleIndex.get_value_or(0), paraLetterSpacing);
+  auto it = m_charStyleProps.find(key);
+  if (it == m_charStyleProps.end())
+  {
+    librevenge::RVNGPropertyList props = buildCharStyleProps(style, defaultCharStyleIndex);
+    if (paraLetterSpacing && !props["fo:letter-spacing"])
+      props.insert("fo:letter-spacing", get(paraLetterSpacing), librevenge::RVNG_POINT);
+    it = m_charStyleProps.insert(std::make_pair(key, props)).first;
+  }
+  return it->second;
+}
+
+librevenge::RVNGPropertyList MSPUBCollector::buildCharStyleProps(const CharacterStyle &style, boost::optional<unsigned> defaultCharStyleIndex) const
 {
   CharacterStyle _nothing;
   if (!defaultCharStyleIndex)
@@ -1944,7 +1973,7 @@ librevenge::RVNGPropertyList MSPUBCollector::getCharStyleProps(const CharacterSt
   {
     librevenge::RVNGString str;
     appendCharacters(str, m_fonts[style.fontIndex.get()],
-                     getCalculatedEncoding());
+                     getCalculatedEncoding(), &m_converters);
     ret.insert("style:font-name", str);
   }
   else if (bool(defaultCharStyle.fontIndex) &&
@@ -1952,14 +1981,14 @@ librevenge::RVNGPropertyList MSPUBCollector::getCharStyleProps(const CharacterSt
   {
     librevenge::RVNGString str;
     appendCharacters(str, m_fonts[defaultCharStyle.fontIndex.get()],
-                     getCalculatedEncoding());
+                     getCalculatedEncoding(), &m_converters);
     ret.insert("style:font-name", str);
   }
   else if (!m_fonts.empty() && !m_fonts[0].empty())
   {
     librevenge::RVNGString str;
     appendCharacters(str, m_fonts[0],
-                     getCalculatedEncoding());
+                     getCalculatedEncoding(), &m_converters);
     ret.insert("style:font-name", str);
   }
   switch (style.superSubType)
@@ -1986,7 +2015,7 @@ librevenge::RVNGPropertyList MSPUBCollector::updateCharStylePropsWithDropCapStyl
   librevenge::RVNGPropertyList props(current);
   if (dropStyle.m_style)
   {
-    auto cProps=getCharStyleProps(*dropStyle.m_style, unsigned(m_defaultCharStyles.size())); // force no default style
+    auto const &cProps=getCharStyleProps(*dropStyle.m_style, unsigned(m_defaultCharStyles.size())); // force no default style
     librevenge::RVNGPropertyList::Iter i(cProps);
     for (i.rewind(); i.next();)
     {
@@ -2004,7 +2033,7 @@ librevenge::RVNGPropertyList MSPUBCollector::updateCharStylePropsWithDropCapStyl
   return props;
 }
 
-librevenge::RVNGString MSPUBCollector::paintDropCap(librevenge::RVNGString const &text, librevenge::RVNGPropertyList &current, DropCapStyle const &dropStyle) const
+librevenge::RVNGString MSPUBCollector::paintDropCap(librevenge::RVNGString const &text, librevenge::RVNGPropertyList const &current, DropCapStyle const &dropStyle) const
 {
   if (text.empty() || dropStyle.empty())
     return text;
@@ -2046,11 +2075,11 @@ void MSPUBCollector::assignShapesToPages()
 {
   for (auto &topLevelShape : m_topLevelShapes)
   {
-    unsigned *ptr_pageSeqNum = getIfExists(m_pageSeqNumsByShapeSeqNum, topLevelShape->getSeqNum());
+    const ShapeInfo *ptr_info = m_shapeInfosBySeqNum.find(topLevelShape->getSeqNum());
     topLevelShape->setup(std::bind(&MSPUBCollector::setupShapeStructures, this, _1));
-    if (ptr_pageSeqNum)
+    if (ptr_info && ptr_info->m_pageSeqNum)
     {
-      PageInfo *ptr_page = getIfExists(m_pagesBySeqNum, *ptr_pageSeqNum);
+      PageInfo *ptr_page = getIfExists(m_pagesBySeqNum, ptr_info->m_pageSeqNum.get());
       if (ptr_page)
       {
         ptr_page->m_shapeGroupsOrdered.push_back(topLevelShape);
@@ -2134,7 +2163,7 @@ void MSPUBCollector::writePageBackground(unsigned pageSeqNum) const
   if (ptr_fillSeqNum)
   {
     std::shared_ptr<const Fill> ptr_fill;
-    const ShapeInfo *ptr_info = getIfExists_const(m_shapeInfosBySeqNum, *ptr_fillSeqNum);
+    const ShapeInfo *ptr_info = m_shapeInfosBySeqNum.find(*ptr_fillSeqNum);
     if (ptr_info)
     {
       ptr_fill = ptr_info->m_fill;
@@ -2173,22 +2202,8 @@ void MSPUBCollector::addPageMasterName(unsigned pageNum, librevenge::RVNGPropert
   m_idToPageMasterNameMap[pageNum]=masterName;
 }
 
-bool MSPUBCollector::go()
+std::vector<unsigned> MSPUBCollector::getPageList() const
 {
-  addBlackToPaletteIfNecessary();
-  assignShapesToPages();
-  m_painter->startDocument(librevenge::RVNGPropertyList());
-  m_painter->setDocumentMetaData(m_metaData);
-
-  for (std::list<EmbeddedFontInfo>::const_iterator i = m_embeddedFonts.begin(); i != m_embeddedFonts.end(); ++i)
-  {
-    librevenge::RVNGPropertyList props;
-    props.insert("librevenge:name", i->m_name);
-    props.insert("librevenge:mime-type", "application/vnd.ms-fontobject");
-    props.insert("office:binary-data",i->m_blob);
-    m_painter->defineEmbeddedFont(props);
-  }
-  // create the list of pages
   std::vector<unsigned> pageList;
   if (m_pageSeqNumsOrdered.empty())
   {
@@ -2208,6 +2223,57 @@ bool MSPUBCollector::go()
         pageList.push_back(i);
     }
   }
+  return pageList;
+}
+
+unsigned MSPUBCollector::getNumPages() const
+{
+  return unsigned(getPageList().size());
+}
+
+unsigned MSPUBCollector::getNumMasterPages() const
+{
+  return unsigned(m_masterPages.size());
+}
+
+bool MSPUBCollector::getPageSize(double &width, double &height) const
+{
+  if (!m_widthSet || !m_heightSet)
+    return false;
+  width = m_width;
+  height = m_height;
+  return true;
+}
+
+bool MSPUBCollector::go()
+{
+  addBlackToPaletteIfNecessary();
+  assignShapesToPages();
+  std::vector<unsigned> pageList = getPageList();
+  // keep only the requested pages: the others are never painted
+  if (m_firstPage > 1 || m_lastPage != std::numeric_limits<unsigned>::max())
+  {
+    if (m_lastPage < pageList.size())
+      pageList.resize(m_lastPage);
+    if (m_firstPage > m_lastPage || m_firstPage > pageList.size())
+    {
+      MSPUB_DEBUG_MSG(("MSPUBCollector::go: no page in the range %u-%u\n", m_firstPage, m_lastPage));
+      return false;
+    }
+    pageList.erase(pageList.begin(), pageList.begin() + (m_firstPage - 1));
+  }
+
+  m_painter->startDocument(librevenge::RVNGPropertyList());
+  m_painter->setDocumentMetaData(m_metaData);
+
+  for (std::list<EmbeddedFontInfo>::const_iterator i = m_embeddedFonts.begin(); i != m_embeddedFonts.end(); ++i)
+  {
+    librevenge::RVNGPropertyList props;
+    props.insert("librevenge:name", i->m_name);
+    props.insert("librevenge:mime-type", "application/vnd.ms-fontobject");
+    props.insert("office:binary-data",i->m_blob);
+    m_painter->defineEmbeddedFont(props);
+  }
   // create the master pages
   std::set<unsigned> masterSet;
   for (unsigned int i : pageList)
@@ -2231,26 +2297,9 @@ bool MSPUBCollector::addTextString(const std::vector<TextParagraph> &str, unsign
 {
   MSPUB_DEBUG_MSG(("addTextString, id: 0x%x\n", id));
   m_textStringsById[id] = str;
-  if (m_encodingHeuristic)
-  {
-    ponderStringEncoding(str);
-  }
   return true; //FIXME: Warn if the string already existed in the map.
 }
 
-void MSPUBCollector::ponderStringEncoding(
-  const std::vector<TextParagraph> &str)
-{
-  for (const auto &i : str)
-  {
-    for (size_t j = 0; j < i.spans.size(); ++j)
-    {
-      const std::vector<unsigned char> &chars = i.spans[j].chars;
-      m_allText.insert(m_allText.end(), chars.begin(), chars.end());
-    }
-  }
-}
-
 void MSPUBCollector::setWidthInEmu(unsigned long widthInEmu)
 {
   //FIXME: Warn if this is called twice
@@ -2275,6 +2324,7 @@ bool MSPUBCollector::addImage(unsigned index, ImgType type, librevenge::RVNGBina
   {
     MSPUB_DEBUG_MSG(("Image at index %u and of type 0x%x added.\n", index, type));
     m_images[index - 1] = std::pair<ImgType, librevenge::RVNGBinaryData>(type, img);
+    m_delayedImages.erase(index);
   }
   else
   {
@@ -2283,6 +2333,101 @@ bool MSPUBCollector::addImage(unsigned index, ImgType type, librevenge::RVNGBina
   return index > 0;
 }
 
+bool MSPUBCollector::addImage(unsigned index, ImgType type, librevenge::RVNGInputStream *input, unsigned long offset, unsigned long length)
+{
+  if (!input || !addImage(index, type, librevenge::RVNGBinaryData()))
+    return false;
+  m_delayedImages.insert(std::make_pair(index, DelayedImage(input, offset, length)));
+  return true;
+}
+
+const std::pair<ImgType, librevenge::RVNGBinaryData> *MSPUBCollector::getImage(unsigned index) const
+{
+  if (index == 0 || index > m_images.size())
+    return nullptr;
+  std::pair<ImgType, librevenge::RVNGBinaryData> &img = m_images[index - 1];
+  auto it = m_delayedImages.find(index);
+  if (it != m_delayedImages.end())
+  {
+    const DelayedImage delayed = it->second;
+    m_delayedImages.erase(it);
+    delayed.m_input->seek(long(delayed.m_offset), librevenge::RVNG_SEEK_SET);
+    readData(delayed.m_input, delayed.m_length, img.second);
+    if (!decodeBlipData(img.first, img.second))
+    {
+      MSPUB_DEBUG_MSG(("MSPUBCollector::getImage: garbage image at index 0x%x\n", index));
+      img = std::pair<ImgType, librevenge::RVNGBinaryData>(UNKNOWN, librevenge::RVNGBinaryData());
+    }
+  }
+  return &img;
+}
+
+const librevenge::RVNGString &MSPUBCollector::getImageBase64(unsigned index) const
+{
+  auto it = m_imagesBase64.find(index);
+  if (it == m_imagesBase64.end())
+  {
+    const std::pair<ImgType, librevenge::RVNGBinaryData> *img = getImage(index);
+    it = m_imagesBase64.insert(std::make_pair(index, img ? img->second.getBase64Data() : librevenge::RVNGString())).first;
+  }
+  return it->second;
+}
+
+const librevenge::RVNGString &MSPUBCollector::getPatternPNGBase64(uint8_t const(&pattern)[8], Color const &col0, Color const &col1) const
+{
+  uint64_t bits = 0;
+  for (int i = 0; i < 8; ++i)
+    bits = (bits << 8) | pattern[i];
+  const auto key = std::make_tuple(bits, getColorKey(col0), getColorKey(col1));
+  auto it = m_patternPNGsBase64.find(key);
+  if (it == m_patternPNGsBase64.end())
+    it = m_patternPNGsBase64.insert(std::make_pair(key, createPNGForSimplePattern(pattern, col0, col1).getBase64Data())).first;
+  return it->second;
+}
+
+unsigned MSPUBCollector::getColorKey(const Color &color)
+{
+  return (unsigned(color.r) << 16) | (unsigned(color.g) << 8) | unsigned(color.b);
+}
+
+std::shared_ptr<const std::vector<Vector2D> > MSPUBCollector::getShapeVertices(const ShapeInfo &info, const std::shared_ptr<const CustomShape> &shape, const std::vector<int> &adjustValues, double aspectRatio) const
+{
+  if (!shape)
+    return std::make_shared<const std::vector<Vector2D> >();
+  // freeform shapes are unique to their ShapeInfo, only the built-in ones are worth caching
+  const CompiledCustomShape *const compiled = info.m_customShape ? nullptr : getCompiledCustomShape(info.m_cropType ? info.m_cropType.get() : info.m_type.get_value_or(RECTANGLE));
+  if (!compiled || compiled->m_shape != shape.get())
+    return std::make_shared<const std::vector<Vector2D> >(resolveVertices(*shape, GuideEvaluator(shape.get(), adjustValues, aspectRatio)));
+  // the shapes depending on the aspect ratio seldom share their vertices
+  if (compiled->m_usesAspectRatio)
+  {
+    const GuideEvaluator guides(shape.get(), compiled->m_guideOrder, adjustValues, aspectRatio);
+    return std::make_shared<const std::vector<Vector2D> >(resolveVertices(*shape, std::cref(guides)));
+  }
+  auto &verticesByAdjustValues = m_builtInShapeVertices[shape.get()];
+  auto it = verticesByAdjustValues.find(adjustValues);
+  if (it == verticesByAdjustValues.end())
+  {
+    const GuideEvaluator guides(shape.get(), compiled->m_guideOrder, adjustValues, 0);
+    it = verticesByAdjustValues.insert(std::make_pair(adjustValues, std::make_shared<const std::vector<Vector2D> >(resolveVertices(*shape, std::cref(guides))))).first;
+  }
+  return it->second;
+}
+
+const librevenge::RVNGString &MSPUBCollector::getOLEPreviewBase64(unsigned oleIndex) const
+{
+  auto it = m_OLEPreviewsBase64.find(oleIndex);
+  if (it == m_OLEPreviewsBase64.end())
+  {
+    librevenge::RVNGString data;
+    auto oleIt = m_OLEs.find(oleIndex);
+    if (oleIt != m_OLEs.end() && !oleIt->second.m_dataList.empty())
+      data = oleIt->second.m_dataList[0].getBase64Data();
+    it = m_OLEPreviewsBase64.insert(std::make_pair(oleIndex, data)).first;
+  }
+  return it->second;
+}
+
 librevenge::RVNGBinaryData *MSPUBCollector::addBorderImage(ImgType type,
                                                            unsigned borderArtIndex)
 {
@@ -2316,7 +2461,6 @@ void MSPUBCollector::setBorderImageOffset(unsigned index, unsigned offset)
 void MSPUBCollector::setShapePage(unsigned seqNum, unsigned pageSeqNum)
 {
   m_shapeInfosBySeqNum[seqNum].m_pageSeqNum = pageSeqNum;
-  m_pageSeqNumsByShapeSeqNum[seqNum] = pageSeqNum;
 }
 
 void MSPUBCollector::addTextColor(ColorReference c)
@@ -13,6 +13,9 @@
 #include <list>
 #include <map>
 #include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -24,8 +27,12 @@
 #include "MSPUBTypes.h"
 #include "PolygonUtils.h"
 #include "ShapeInfo.h"
+#include "ShapeTable.h"
 #include "ShapeType.h"
+#include "TextArena.h"
+#include "VectorTransformation2D.h"
 #include "VerticalAlign.h"
+#include "libmspub_utils.h"
 
 namespace libmspub
 {
@@ -62,8 +69,15 @@ public:
 
   bool addPage(unsigned seqNum);
   bool addTextString(const std::vector<TextParagraph> &str, unsigned id);
+  //! The text of the document, which the spans of text strings refer to
+  TextArena &getTextArena()
+  {
+    return m_textArena;
+  }
   void addTextShape(unsigned stringId, unsigned seqNum);
   bool addImage(unsigned index, ImgType type, librevenge::RVNGBinaryData const &img);
+  //! Adds an image whose data is only read from input and decoded when it is used
+  bool addImage(unsigned index, ImgType type, librevenge::RVNGInputStream *input, unsigned long offset, unsigned long length);
   void setBorderImageOffset(unsigned index, unsigned offset);
   librevenge::RVNGBinaryData *addBorderImage(ImgType type, unsigned borderArtIndex);
   bool addOLE(unsigned index, EmbeddedObject const &ole);
@@ -89,7 +103,6 @@ public:
   void setShapeFlip(unsigned, bool, bool);
   void setShapeMargins(unsigned seqNum, unsigned left, unsigned top, unsigned right, unsigned bottom);
   void setShapeBorderPosition(unsigned seqNum, BorderPosition pos);
-  void setShapeCoordinatesRotated90(unsigned seqNum);
   void setShapeCustomPath(unsigned seqNum,
                           const DynamicCustomShape &shape);
   void setShapeClipPath(unsigned seqNum, const std::vector<libmspub::Vertex> &clip);
@@ -132,9 +145,17 @@ public:
   std::vector<CellStyle> const *getTableCellTextStyles(unsigned seqNum) const;
   void setTextStringOffset(unsigned textId, unsigned offset);
 
+  //! Restricts the output to the pages firstPage to lastPage, numbered from 1
+  void setPageRange(unsigned firstPage, unsigned lastPage);
+
   bool go();
 
   bool hasPage(unsigned seqNum) const;
+  //! Returns the number of pages go would send, before any page range is applied
+  unsigned getNumPages() const;
+  unsigned getNumMasterPages() const;
+  //! Sets width and height to the page size in inches, if it is known
+  bool getPageSize(double &width, double &height) const;
 private:
 
   struct PageInfo
@@ -142,6 +163,15 @@ private:
     std::vector<std::shared_ptr<ShapeGroupElement>> m_shapeGroupsOrdered;
     PageInfo() : m_shapeGroupsOrdered() { }
   };
+  //! the position of the data of an image which is not decoded yet
+  struct DelayedImage
+  {
+    DelayedImage(librevenge::RVNGInputStream *input, unsigned long offset, unsigned long length)
+      : m_input(input), m_offset(offset), m_length(length) { }
+    librevenge::RVNGInputStream *m_input;
+    unsigned long m_offset;
+    unsigned long m_length;
+  };
 
   MSPUBCollector(const MSPUBCollector &);
   MSPUBCollector &operator=(const MSPUBCollector &);
@@ -155,44 +185,60 @@ private:
   unsigned short m_numPages;
   std::map<unsigned, std::vector<TextParagraph> > m_textStringsById;
   std::map<unsigned, PageInfo> m_pagesBySeqNum;
-  std::vector<std::pair<ImgType, librevenge::RVNGBinaryData> > m_images;
+  mutable std::vector<std::pair<ImgType, librevenge::RVNGBinaryData> > m_images;
+  mutable std::map<unsigned, DelayedImage> m_delayedImages;
+  mutable std::map<unsigned, librevenge::RVNGString> m_imagesBase64;
+  //! the base64 form of DIB patterns recolored by PatternFill, by image index and colors
+  mutable std::map<std::tuple<unsigned, unsigned, unsigned>, librevenge::RVNGString> m_recoloredImagesBase64;
+  mutable std::map<unsigned, librevenge::RVNGString> m_OLEPreviewsBase64;
+  //! the base64 form of the Pattern88Fill pictures, by pattern bits and colors
+  mutable std::map<std::tuple<uint64_t, unsigned, unsigned>, librevenge::RVNGString> m_patternPNGsBase64;
+  //! the evaluated vertices of the built-in shapes which do not depend on the aspect ratio, by shape and adjust values
+  mutable std::map<const CustomShape *, std::map<std::vector<int>, std::shared_ptr<const std::vector<Vector2D> > > > m_builtInShapeVertices;
   std::vector<BorderArtInfo> m_borderImages;
   std::map<unsigned, EmbeddedObject> m_OLEs;
   std::vector<ColorReference> m_textColors;
   std::vector<std::vector<unsigned char> > m_fonts;
   std::vector<CharacterStyle> m_defaultCharStyles;
   std::vector<ParagraphStyle> m_defaultParaStyles;
-  std::map<unsigned, ShapeType> m_shapeTypesBySeqNum;
   std::vector<Color> m_paletteColors;
   std::vector<unsigned> m_shapeSeqNumsOrdered;
-  std::map<unsigned, unsigned> m_pageSeqNumsByShapeSeqNum;
   std::map<unsigned, unsigned> m_bgShapeSeqNumsByPageSeqNum;
   std::set<unsigned> m_skipIfNotBgSeqNums;
   std::shared_ptr<ShapeGroupElement> m_currentShapeGroup;
   std::vector<std::shared_ptr<ShapeGroupElement>> m_topLevelShapes;
-  std::map<unsigned, std::shared_ptr<ShapeGroupElement>> m_groupsBySeqNum;
   std::list<EmbeddedFontInfo> m_embeddedFonts;
-  std::map<unsigned, ShapeInfo> m_shapeInfosBySeqNum;
+  ShapeTable m_shapeInfosBySeqNum;
   std::set<unsigned> m_masterPages;
-  std::set<unsigned> m_shapesWithCoordinatesRotated90;
   std::map<unsigned, unsigned> m_masterPagesByPageSeqNum;
   std::map<unsigned, std::vector<unsigned> > m_tableCellTextEndsByTextId;
   std::map<unsigned, unsigned> m_stringOffsetsByTextId;
   std::map<unsigned, std::vector<CellStyle> > m_tableCellStylesByTextId;
-  mutable std::vector<bool> m_calculationValuesSeen;
   std::vector<unsigned> m_pageSeqNumsOrdered;
+  unsigned m_firstPage, m_lastPage;
   bool m_encodingHeuristic;
-  std::vector<unsigned char> m_allText;
+  TextArena m_textArena;
   mutable boost::optional<const char *> m_calculatedEncoding;
   mutable std::vector<const char *> m_fontsEncoding;
+  //! the ICU converters used to decode the text of the document
+  mutable ConverterCache m_converters;
+  //! the properties of the character and paragraph styles, by style and default style
+  mutable std::unordered_map<std::string, librevenge::RVNGPropertyList> m_charStyleProps;
+  mutable std::unordered_map<std::string, librevenge::RVNGPropertyList> m_paraStyleProps;
   librevenge::RVNGPropertyList m_metaData;
   mutable std::map<unsigned, librevenge::RVNGString> m_idToPageMasterNameMap;
 
   // helper functions
   std::vector<int> getShapeAdjustValues(const ShapeInfo &info) const;
+  const std::pair<ImgType, librevenge::RVNGBinaryData> *getImage(unsigned index) const;
+  const librevenge::RVNGString &getImageBase64(unsigned index) const;
+  const librevenge::RVNGString &getOLEPreviewBase64(unsigned oleIndex) const;
+  const librevenge::RVNGString &getPatternPNGBase64(uint8_t const(&pattern)[8], Color const &col0, Color const &col1) const;
+  static unsigned getColorKey(const Color &color);
+  std::shared_ptr<const std::vector<Vector2D> > getShapeVertices(const ShapeInfo &info, const std::shared_ptr<const CustomShape> &shape, const std::vector<int> &adjustValues, double aspectRatio) const;
   boost::optional<unsigned> getMasterPageSeqNum(unsigned pageSeqNum) const;
   void setRectCoordProps(Coordinate, librevenge::RVNGPropertyList *) const;
-  boost::optional<std::vector<libmspub::TextParagraph> > getShapeText(const ShapeInfo &info) const;
+  const std::vector<libmspub::TextParagraph> *getShapeText(const ShapeInfo &info) const;
   void setupShapeStructures(ShapeGroupElement &elt);
   void addBlackToPaletteIfNecessary();
   void assignShapesToPages();
@@ -206,20 +252,23 @@ private:
   void closeTextLine(TextLineState &state, bool lastLine) const;
   void closeTextList(TextLineState &state) const;
   bool pageIsMaster(unsigned pageSeqNum) const;
+  //! Returns the normal pages, in the order of the document
+  std::vector<unsigned> getPageList() const;
   void addPageMasterName(unsigned pageNum, librevenge::RVNGPropertyList &propList, bool createIsNeeded) const;
 
   std::function<void(void)> paintShape(const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform) const;
   void paintTable(const ShapeInfo &info, std::vector<TextParagraph> const &text, librevenge::RVNGPropertyList const &frameProps) const;
   void paintTextObject(const ShapeInfo &info, std::vector<TextParagraph> const &text, librevenge::RVNGPropertyList const &frameProps) const;
-  double getCalculationValue(const ShapeInfo &info, unsigned index, bool recursiveEntry, const std::vector<int> &adjustValues) const;
 
   // hack to try to create some drop cap letters...
-  librevenge::RVNGString paintDropCap(librevenge::RVNGString const &text, librevenge::RVNGPropertyList &current, DropCapStyle const &dropStyle) const;
-  librevenge::RVNGPropertyList getCharStyleProps(const CharacterStyle &, boost::optional<unsigned> defaultCharStyleIndex) const;
+  librevenge::RVNGString paintDropCap(librevenge::RVNGString const &text, librevenge::RVNGPropertyList const &current, DropCapStyle const &dropStyle) const;
+  //! Returns the properties of a character style in a paragraph with the given letter spacing, computed once for each distinct style
+  const librevenge::RVNGPropertyList &getCharStyleProps(const CharacterStyle &, boost::optional<unsigned> defaultCharStyleIndex, const boost::optional<double> &paraLetterSpacing = boost::none) const;
+  librevenge::RVNGPropertyList buildCharStyleProps(const CharacterStyle &, boost::optional<unsigned> defaultCharStyleIndex) const;
   librevenge::RVNGPropertyList updateCharStylePropsWithDropCapStyle(librevenge::RVNGPropertyList const &current, DropCapStyle const &dropStyle) const;
-  librevenge::RVNGPropertyList getParaStyleProps(const ParagraphStyle &, boost::optional<unsigned> defaultParaStyleIndex) const;
-  double getSpecialValue(const ShapeInfo &info, const CustomShape &shape, int arg, const std::vector<int> &adjustValues) const;
-  void ponderStringEncoding(const std::vector<TextParagraph> &str);
+  //! Returns the properties of a paragraph style, computed once for each distinct style
+  const librevenge::RVNGPropertyList &getParaStyleProps(const ParagraphStyle &, boost::optional<unsigned> defaultParaStyleIndex) const;
+  librevenge::RVNGPropertyList buildParaStyleProps(const ParagraphStyle &, boost::optional<unsigned> defaultParaStyleIndex) const;
   const char *getCalculatedEncoding() const;
   const char *getCalculatedEncoding(boost::optional<unsigned> fontIndex) const;
   void createFontsEncoding() const;
@@ -9,13 +9,16 @@
 
 #include <libmspub/libmspub.h>
 
+#include <limits>
 #include <memory>
 
 #include "MSPUBCollector.h"
+#include "MSPUBMetaData.h"
 #include "MSPUBParser.h"
 #include "MSPUBParser2k.h"
 #include "MSPUBParser91.h"
 #include "MSPUBParser97.h"
+#include "SubStreamCache.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
@@ -24,18 +27,11 @@ namespace libmspub
 namespace
 {
 
-enum MSPUBVersion
-{
-  MSPUB_UNKNOWN_VERSION = 0,
-  MSPUB_1,
-  MSPUB_2K,
-  MSPUB_2K2
-};
-
-MSPUBVersion getVersion(librevenge::RVNGInputStream *input)
+MSPUBVersion getVersion(SubStreamCache &subStreams)
 {
   try
   {
+    librevenge::RVNGInputStream *input = subStreams.getInput();
     if (!input->isStructured())
     {
       input->seek(0, librevenge::RVNG_SEEK_SET);
@@ -44,16 +40,16 @@ MSPUBVersion getVersion(librevenge::RVNGInputStream *input)
       return MSPUB_1;
     }
 
-    std::unique_ptr<librevenge::RVNGInputStream> contentsStream(input->getSubStreamByName("Contents"));
+    librevenge::RVNGInputStream *contentsStream = subStreams.getSubStream("Contents");
     if (!contentsStream)
       return MSPUB_UNKNOWN_VERSION;
 
-    if (0xe8 != readU8(contentsStream.get()) || 0xac != readU8(contentsStream.get()))
+    if (0xe8 != readU8(contentsStream) || 0xac != readU8(contentsStream))
       return MSPUB_UNKNOWN_VERSION;
 
-    unsigned char magicVersionByte = readU8(contentsStream.get());
+    unsigned char magicVersionByte = readU8(contentsStream);
 
-    if (0x00 != readU8(contentsStream.get()))
+    if (0x00 != readU8(contentsStream))
       return MSPUB_UNKNOWN_VERSION;
 
     MSPUBVersion version = MSPUB_UNKNOWN_VERSION;
@@ -77,6 +73,34 @@ MSPUBVersion getVersion(librevenge::RVNGInputStream *input)
 
 }
 
+std::unique_ptr<MSPUBParser> createParser(MSPUBVersion version, SubStreamCache &subStreams, MSPUBCollector &collector)
+{
+  std::unique_ptr<MSPUBParser> parser;
+  switch (version)
+  {
+  case MSPUB_1:
+    parser.reset(new MSPUBParser91(subStreams, &collector));
+    break;
+  case MSPUB_2K:
+  {
+    if (!subStreams.getSubStream("Quill/QuillSub/CONTENTS"))
+      parser.reset(new MSPUBParser97(subStreams, &collector));
+    else
+      parser.reset(new MSPUBParser2k(subStreams, &collector));
+    break;
+  }
+  case MSPUB_2K2:
+  {
+    parser.reset(new MSPUBParser(subStreams, &collector));
+    break;
+  }
+  case MSPUB_UNKNOWN_VERSION:
+  default:
+    break;
+  }
+  return parser;
+}
+
 } // anonymous namespace
 
 
@@ -94,17 +118,16 @@ PUBAPI bool MSPUBDocument::isSupported(librevenge::RVNGInputStream *input)
 
   try
   {
-    MSPUBVersion version = getVersion(input);
+    SubStreamCache subStreams(input);
+    MSPUBVersion version = getVersion(subStreams);
     if (version == MSPUB_UNKNOWN_VERSION)
       return false;
 
     if (version == MSPUB_2K2)
     {
-      std::unique_ptr<librevenge::RVNGInputStream> escherStream(input->getSubStreamByName("Escher/EscherStm"));
-      if (!escherStream)
+      if (!subStreams.getSubStream("Escher/EscherStm"))
         return false;
-      std::unique_ptr<librevenge::RVNGInputStream> quillStream(input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
-      if (!quillStream)
+      if (!subStreams.getSubStream("Quill/QuillSub/CONTENTS"))
         return false;
     }
     return true;
@@ -115,6 +138,106 @@ PUBAPI bool MSPUBDocument::isSupported(librevenge::RVNGInputStream *input)
   }
 }
 
+/**
+Reads the format, the page list and the page size of a document, without
+parsing the shapes and the text nor calling any painter.
+\param input The input stream
+\param info The structure which receives what is found
+\return A value that indicates whether the document could be probed
+*/
+PUBAPI bool MSPUBDocument::probe(librevenge::RVNGInputStream *input, MSPUBDocumentInfo &info)
+{
+  info = MSPUBDocumentInfo();
+  if (!input)
+    return false;
+
+  try
+  {
+    MSPUBCollector collector(nullptr);
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+    SubStreamCache subStreams(input);
+    const MSPUBVersion version = getVersion(subStreams);
+    std::unique_ptr<MSPUBParser> parser = createParser(version, subStreams, collector);
+    if (!parser || !parser->probe())
+      return false;
+    info.m_version = version;
+    info.m_numPages = collector.getNumPages();
+    info.m_numMasterPages = collector.getNumMasterPages();
+    collector.getPageSize(info.m_width, info.m_height);
+    return true;
+  }
+  catch (...)
+  {
+    return false;
+  }
+}
+
+/**
+Reads the metadata of a document (title, author, dates...) from its summary
+information streams, without parsing its content.
+\param input The input stream
+\param metaData The property list which receives the metadata
+\return A value that indicates whether the document has summary information
+*/
+PUBAPI bool MSPUBDocument::parseMetaData(librevenge::RVNGInputStream *input, librevenge::RVNGPropertyList &metaData)
+{
+  metaData.clear();
+  if (!input)
+    return false;
+
+  try
+  {
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+    SubStreamCache subStreams(input);
+    MSPUBMetaData parser;
+    if (!parser.parseDocument(subStreams))
+      return false;
+    metaData = parser.getMetaData();
+    return true;
+  }
+  catch (...)
+  {
+    return false;
+  }
+}
+
+/**
+Reads the preview picture which Publisher stores in the summary information
+of a document, without parsing its content.
+\param input The input stream
+\param thumbnail The data of the picture, a WMF, EMF or BMP file
+\param mimeType The mime type of the picture
+\return A value that indicates whether the document has a preview picture
+*/
+PUBAPI bool MSPUBDocument::parseThumbnail(librevenge::RVNGInputStream *input, librevenge::RVNGBinaryData &thumbnail, librevenge::RVNGString &mimeType)
+{
+  thumbnail.clear();
+  mimeType.clear();
+  if (!input)
+    return false;
+
+  try
+  {
+    input->seek(0, librevenge::RVNG_SEEK_SET);
+    SubStreamCache subStreams(input);
+    librevenge::RVNGInputStream *summaryInfo = subStreams.getSubStream("\x05SummaryInformation");
+    if (!summaryInfo)
+      return false;
+    MSPUBMetaData parser;
+    parser.setExtractThumbnail(true);
+    parser.parse(summaryInfo);
+    if (parser.getThumbnailType() == UNKNOWN)
+      return false;
+    thumbnail = parser.getThumbnail();
+    mimeType = mimeByImgType(parser.getThumbnailType());
+    return true;
+  }
+  catch (...)
+  {
+    return false;
+  }
+}
+
 /**
 Parses the input stream content. It will make callbacks to the functions provided by a
 RVNGDrawingInterface class implementation when needed. This is often commonly called the
@@ -124,6 +247,25 @@ RVNGDrawingInterface class implementation when needed. This is often commonly ca
 \return A value that indicates whether the parsing was successful
 */
 PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter)
+{
+  return parse(input, painter, 1, std::numeric_limits<unsigned>::max());
+}
+
+/**
+Parses the input stream content, but only sends the pages firstPage to lastPage
+to the painter, along with the master pages they use. The other pages are not
+painted, so their images are never decoded nor their text converted.
+The painter receives the kept pages as a whole document: page number and
+page count fields are computed by the consumer from these pages only, so
+they show 1 to n instead of the numbers of the pages in the full document.
+\param input The input stream
+\param painter A MSPUBPainterInterface implementation
+\param firstPage The first page to send, numbered from 1
+\param lastPage The last page to send, included
+\return A value that indicates whether the parsing was successful and
+the range contained at least one page
+*/
+PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge::RVNGDrawingInterface *painter, unsigned firstPage, unsigned lastPage)
 {
   if (!input || !painter)
     return false;
@@ -131,31 +273,10 @@ PUBAPI bool MSPUBDocument::parse(librevenge::RVNGInputStream *input, librevenge:
   try
   {
     MSPUBCollector collector(painter);
+    collector.setPageRange(firstPage, lastPage);
     input->seek(0, librevenge::RVNG_SEEK_SET);
-    std::unique_ptr<MSPUBParser> parser;
-    switch (getVersion(input))
-    {
-    case MSPUB_1:
-      parser.reset(new MSPUBParser91(input, &collector));
-      break;
-    case MSPUB_2K:
-    {
-      std::unique_ptr<librevenge::RVNGInputStream> quillStream(input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
-      if (!quillStream)
-        parser.reset(new MSPUBParser97(input, &collector));
-      else
-        parser.reset(new MSPUBParser2k(input, &collector));
-      break;
-    }
-    case MSPUB_2K2:
-    {
-      parser.reset(new MSPUBParser(input, &collector));
-      break;
-    }
-    case MSPUB_UNKNOWN_VERSION:
-    default:
-      return false;
-    }
+    SubStreamCache subStreams(input);
+    std::unique_ptr<MSPUBParser> parser = createParser(getVersion(subStreams), subStreams, collector);
     if (parser)
     {
       return parser->parse();
@@ -15,10 +15,12 @@
 #include <ctime>
 #include <string>
 
+#include "SubStreamCache.h"
 #include "libmspub_utils.h"
 
 libmspub::MSPUBMetaData::MSPUBMetaData()
   : m_idsAndOffsets(), m_typedPropertyValues(), m_metaData()
+  , m_thumbnailType(libmspub::UNKNOWN), m_thumbnail(), m_extractThumbnail(false)
 {
 }
 
@@ -169,6 +171,12 @@ void libmspub::MSPUBMetaData::readPropertyIdentifierAndOffset(librevenge::RVNGIn
 
 #define VT_I2 0x0002
 #define VT_LPSTR 0x001E
+#define VT_CF 0x0047
+
+// the Windows clipboard formats a thumbnail can have
+#define CF_METAFILEPICT 3
+#define CF_DIB 8
+#define CF_ENHMETAFILE 14
 
 void libmspub::MSPUBMetaData::readTypedPropertyValue(librevenge::RVNGInputStream *input,
                                                      uint32_t index,
@@ -185,6 +193,12 @@ void libmspub::MSPUBMetaData::readTypedPropertyValue(librevenge::RVNGInputStream
     uint16_t value = readU16(input);
     m_typedPropertyValues[uint16_t(index)] = value;
   }
+  else if (type == VT_CF)
+  {
+    if (m_extractThumbnail && index < m_idsAndOffsets.size() && m_idsAndOffsets[index].first == PIDSI::PIDSI_THUMBNAIL &&
+        !strcmp(FMTID, "f29f85e0-4ff9-1068-ab91-08002b27b3d9"))
+      readThumbnail(input);
+  }
   else if (type == VT_LPSTR)
   {
     librevenge::RVNGString string = readCodePageString(input);
@@ -286,6 +300,74 @@ librevenge::RVNGString libmspub::MSPUBMetaData::readCodePageString(librevenge::R
   return string;
 }
 
+void libmspub::MSPUBMetaData::readThumbnail(librevenge::RVNGInputStream *input)
+{
+  // ClipboardData: the size of what follows, a format tag (-1 for a
+  // Windows clipboard format), the clipboard format and the data
+  uint32_t size = readU32(input);
+  if (size < 8)
+    return;
+  if (readS32(input) != -1)
+  {
+    MSPUB_DEBUG_MSG(("MSPUBMetaData::readThumbnail: not a Windows clipboard format\n"));
+    return;
+  }
+  uint32_t format = readU32(input);
+  unsigned long length = size - 8;
+  ImgType type = libmspub::UNKNOWN;
+  switch (format)
+  {
+  case CF_METAFILEPICT:
+    // skip the METAFILEPICT header: mapping mode, extents, handle
+    if (length <= 8)
+      return;
+    input->seek(8, librevenge::RVNG_SEEK_CUR);
+    length -= 8;
+    type = libmspub::WMF;
+    break;
+  case CF_DIB:
+    type = libmspub::DIB;
+    break;
+  case CF_ENHMETAFILE:
+    type = libmspub::EMF;
+    break;
+  default:
+    MSPUB_DEBUG_MSG(("MSPUBMetaData::readThumbnail: unknown clipboard format %u\n", unsigned(format)));
+    return;
+  }
+  librevenge::RVNGBinaryData data;
+  if (!readData(input, length, data) || data.empty())
+    return;
+  // a DIB needs a BMP file header
+  if (type == libmspub::DIB && !decodeBlipData(type, data))
+    return;
+  m_thumbnailType = type;
+  m_thumbnail = data;
+}
+
+bool libmspub::MSPUBMetaData::parseDocument(SubStreamCache &subStreams)
+{
+  librevenge::RVNGInputStream *input = subStreams.getInput();
+  if (!input || !input->isStructured())
+    return false;
+
+  librevenge::RVNGInputStream *sumaryInfo = subStreams.getSubStream("\x05SummaryInformation");
+  if (sumaryInfo)
+  {
+    parse(sumaryInfo);
+  }
+
+  librevenge::RVNGInputStream *docSumaryInfo = subStreams.getSubStream("\005DocumentSummaryInformation");
+  if (docSumaryInfo)
+  {
+    parse(docSumaryInfo);
+  }
+
+  input->seek(0, librevenge::RVNG_SEEK_SET);
+  parseTimes(input);
+  return sumaryInfo || docSumaryInfo;
+}
+
 bool libmspub::MSPUBMetaData::parseTimes(librevenge::RVNGInputStream *input)
 {
   // Parse the header
@@ -338,9 +420,24 @@ bool libmspub::MSPUBMetaData::parseTimes(librevenge::RVNGInputStream *input)
   return false;
 }
 
+void libmspub::MSPUBMetaData::setExtractThumbnail(bool extract)
+{
+  m_extractThumbnail = extract;
+}
+
 const librevenge::RVNGPropertyList &libmspub::MSPUBMetaData::getMetaData()
 {
   return m_metaData;
 }
 
+libmspub::ImgType libmspub::MSPUBMetaData::getThumbnailType() const
+{
+  return m_thumbnailType;
+}
+
+const librevenge::RVNGBinaryData &libmspub::MSPUBMetaData::getThumbnail() const
+{
+  return m_thumbnail;
+}
+
 /* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -19,9 +19,13 @@
 
 #include <librevenge-stream/librevenge-stream.h>
 
+#include "MSPUBTypes.h"
+
 namespace libmspub
 {
 
+class SubStreamCache;
+
 class MSPUBMetaData
 {
 public:
@@ -29,7 +33,14 @@ public:
   ~MSPUBMetaData();
   bool parse(librevenge::RVNGInputStream *input);
   bool parseTimes(librevenge::RVNGInputStream *input);
+  //! Makes parse() also extract the preview picture; it is skipped by default
+  void setExtractThumbnail(bool extract);
+  //! Reads the summary information streams and the times of the root storage of a document; returns false if there is no summary information
+  bool parseDocument(SubStreamCache &subStreams);
   const librevenge::RVNGPropertyList &getMetaData();
+  //! Returns the preview picture stored in the summary information, UNKNOWN if there is none
+  ImgType getThumbnailType() const;
+  const librevenge::RVNGBinaryData &getThumbnail() const;
 
 private:
   MSPUBMetaData(const MSPUBMetaData &);
@@ -40,12 +51,16 @@ private:
   void readPropertyIdentifierAndOffset(librevenge::RVNGInputStream *input);
   void readTypedPropertyValue(librevenge::RVNGInputStream *input, uint32_t index, uint32_t offset, char *FMTID);
   librevenge::RVNGString readCodePageString(librevenge::RVNGInputStream *input);
+  void readThumbnail(librevenge::RVNGInputStream *input);
 
   uint32_t getCodePage();
 
   std::vector< std::pair<uint32_t, uint32_t> > m_idsAndOffsets;
   std::map<uint16_t, uint16_t> m_typedPropertyValues;
   librevenge::RVNGPropertyList m_metaData;
+  ImgType m_thumbnailType;
+  librevenge::RVNGBinaryData m_thumbnail;
+  bool m_extractThumbnail;
 };
 
 } // namespace libmspub
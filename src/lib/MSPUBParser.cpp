@@ -23,6 +23,7 @@
 #include <librevenge-stream/librevenge-stream.h>
 
 #include "Arrow.h"
+#include "ByteReader.h"
 #include "ColorReference.h"
 #include "Coordinate.h"
 #include "Dash.h"
@@ -41,7 +42,9 @@
 #include "Shadow.h"
 #include "ShapeFlags.h"
 #include "ShapeType.h"
+#include "SubStreamCache.h"
 #include "TableInfo.h"
+#include "TextArena.h"
 #include "VerticalAlign.h"
 #include "libmspub_utils.h"
 
@@ -99,18 +102,20 @@ Underline readUnderline(const unsigned value)
 
 }
 
-MSPUBParser::MSPUBParser(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
-  : m_input(input),
-    m_length(boost::numeric_cast<unsigned>(getLength(input))),
+MSPUBParser::MSPUBParser(SubStreamCache &subStreams, MSPUBCollector *collector)
+  : m_input(subStreams.getInput()),
+    m_subStreams(subStreams),
+    m_length(boost::numeric_cast<unsigned>(getLength(m_input))),
     m_collector(collector),
     m_blockInfo(), m_contentChunks(),
-    m_cellsChunkIndices(),
     m_pageChunkIndices(), m_shapeChunkIndices(),
     m_paletteChunkIndices(), m_borderArtChunkIndices(),
     m_fontChunkIndices(),
     m_unknownChunkIndices(), m_documentChunkIndex(),
     m_lastSeenSeqNum(-1), m_lastAddedImage(0),
-    m_alternateShapeSeqNums(), m_escherDelayIndices()
+    m_alternateShapeSeqNums(), m_escherDelayIndices(),
+    m_escherIndex(),
+    m_probing(false)
 {
 }
 
@@ -185,40 +190,40 @@ bool MSPUBParser::parse()
     return false;
   // No check: metadata are not important enough to fail if they can't be parsed
   parseMetaData();
-  std::unique_ptr<librevenge::RVNGInputStream> quill(m_input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
+  librevenge::RVNGInputStream *quill = m_subStreams.getSubStream("Quill/QuillSub/CONTENTS");
   if (!quill)
   {
     MSPUB_DEBUG_MSG(("Couldn't get quill stream.\n"));
     return false;
   }
-  if (!parseQuill(quill.get()))
+  if (!parseQuill(quill))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse quill stream.\n"));
     return false;
   }
-  std::unique_ptr<librevenge::RVNGInputStream> contents(m_input->getSubStreamByName("Contents"));
+  librevenge::RVNGInputStream *contents = m_subStreams.getSubStream("Contents");
   if (!contents)
   {
     MSPUB_DEBUG_MSG(("Couldn't get contents stream.\n"));
     return false;
   }
-  if (!parseContents(contents.get()))
+  if (!parseContents(contents))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse contents stream.\n"));
     return false;
   }
-  std::unique_ptr<librevenge::RVNGInputStream> escherDelay(m_input->getSubStreamByName("Escher/EscherDelayStm"));
+  librevenge::RVNGInputStream *escherDelay = m_subStreams.getSubStream("Escher/EscherDelayStm");
   if (escherDelay)
   {
-    parseEscherDelay(escherDelay.get());
+    parseEscherDelay(escherDelay);
   }
-  std::unique_ptr<librevenge::RVNGInputStream> escher(m_input->getSubStreamByName("Escher/EscherStm"));
+  librevenge::RVNGInputStream *escher = m_subStreams.getSubStream("Escher/EscherStm");
   if (!escher)
   {
     MSPUB_DEBUG_MSG(("Couldn't get escher stream.\n"));
     return false;
   }
-  if (!parseEscher(escher.get()))
+  if (!parseEscher(escher))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse escher stream.\n"));
     return false;
@@ -227,6 +232,18 @@ bool MSPUBParser::parse()
   return m_collector->go();
 }
 
+bool MSPUBParser::probe()
+{
+  m_probing = true;
+  librevenge::RVNGInputStream *contents = m_input->isStructured() ? m_subStreams.getSubStream("Contents") : m_input;
+  if (!contents)
+  {
+    MSPUB_DEBUG_MSG(("MSPUBParser::probe: Couldn't get contents stream.\n"));
+    return false;
+  }
+  return parseContents(contents);
+}
+
 ImgType MSPUBParser::imgTypeByBlipType(unsigned short type)
 {
   switch (type)
@@ -303,61 +320,9 @@ bool MSPUBParser::parseEscherDelay(librevenge::RVNGInputStream *input)
     const ImgType imgType = imgTypeByBlipType(info.type);
     if (imgType != UNKNOWN)
     {
-      librevenge::RVNGBinaryData img;
-      unsigned long toRead = info.contentsLength;
-      input->seek(long(input->tell() + getStartOffset(imgType, info.initial)), librevenge::RVNG_SEEK_SET);
-      readData(input, toRead, img);
-      if (imgType == WMF || imgType == EMF)
-      {
-        img = inflateData(img);
-      }
-      else if (imgType == DIB)
-      {
-        // Reconstruct BMP header
-        // cf. http://en.wikipedia.org/wiki/BMP_file_format , accessed 2012-5-31
-        librevenge::RVNGInputStream *buf = img.getDataStream();
-        if (img.size() < 0x2E + 4)
-        {
-          ++m_lastAddedImage;
-          MSPUB_DEBUG_MSG(("Garbage DIB at index 0x%x\n", m_lastAddedImage));
-          input->seek(long(info.contentsOffset + info.contentsLength), librevenge::RVNG_SEEK_SET);
-          continue;
-        }
-        buf->seek(0x0E, librevenge::RVNG_SEEK_SET);
-        unsigned short bitsPerPixel = readU16(buf);
-        buf->seek(0x20, librevenge::RVNG_SEEK_SET);
-        unsigned numPaletteColors = readU32(buf);
-        if (numPaletteColors == 0 && bitsPerPixel <= 8)
-        {
-          numPaletteColors = 1;
-          for (int i = 0; i < bitsPerPixel; ++i)
-          {
-            numPaletteColors *= 2;
-          }
-        }
-
-        librevenge::RVNGBinaryData tmpImg;
-        tmpImg.append(static_cast<unsigned char>(0x42));
-        tmpImg.append(static_cast<unsigned char>(0x4d));
-
-        tmpImg.append(static_cast<unsigned char>((img.size() + 14) & 0x000000ff));
-        tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0x0000ff00) >> 8));
-        tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0x00ff0000) >> 16));
-        tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0xff000000) >> 24));
-
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-
-        tmpImg.append(static_cast<unsigned char>(0x36 + 4 * numPaletteColors));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(static_cast<unsigned char>(0x00));
-        tmpImg.append(img);
-        img = tmpImg;
-      }
-      m_collector->addImage(++m_lastAddedImage, imgType, img);
+      // only remember where the picture is, it is decoded when a fill uses it
+      const unsigned long dataOffset = static_cast<unsigned long>(input->tell()) + static_cast<unsigned long>(getStartOffset(imgType, info.initial));
+      m_collector->addImage(++m_lastAddedImage, imgType, input, dataOffset, info.contentsLength);
     }
     else
     {
@@ -409,6 +374,13 @@ bool MSPUBParser::parseContents(librevenge::RVNGInputStream *input)
         return false;
       }
       const ContentChunkReference &documentChunk = m_contentChunks.at(m_documentChunkIndex.get());
+      if (m_probing)
+      {
+        m_paletteChunkIndices.clear();
+        m_borderArtChunkIndices.clear();
+        m_shapeChunkIndices.clear();
+        m_fontChunkIndices.clear();
+      }
       for (unsigned int paletteChunkIndex : m_paletteChunkIndices)
       {
         const ContentChunkReference &paletteChunk = m_contentChunks.at(paletteChunkIndex);
@@ -760,21 +732,13 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
         MSPUB_DEBUG_MSG(("ERROR: Wrong number of rows or columns found in table definition.\n"));
         return false;
       }
-      boost::optional<unsigned> index;
-      for (size_t i = 0; i < m_cellsChunkIndices.size(); ++i)
-      {
-        if (m_contentChunks[m_cellsChunkIndices[i]].seqNum == csn)
-        {
-          index = i;
-          break;
-        }
-      }
+      const ContentChunkReference *const cellsChunkPtr = m_contentChunks.find(csn);
 
       TableInfo ti(nr, nc);
       ti.m_rowHeightsInEmu = rowHeightsInEmu;
       ti.m_columnWidthsInEmu = columnWidthsInEmu;
 
-      if (!index)
+      if (!cellsChunkPtr || cellsChunkPtr->type != CELLS)
       {
         MSPUB_DEBUG_MSG(("WARNING: Couldn't find cells of seqnum %u corresponding to table of seqnum %u.\n",
                          csn, chunk.seqNum));
@@ -782,7 +746,7 @@ bool MSPUBParser::parseShape(librevenge::RVNGInputStream *input,
       }
       else
       {
-        const ContentChunkReference &cellsChunk = m_contentChunks[m_cellsChunkIndices[get(index)]];
+        const ContentChunkReference &cellsChunk = *cellsChunkPtr;
         input->seek(long(cellsChunk.offset), librevenge::RVNG_SEEK_SET);
         const unsigned cellsLength = readU32(input);
         boost::optional<unsigned> cellCount;
@@ -1072,6 +1036,10 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
   if (parsedStrs && parsedSyid && parsedFdpc && parsedFdpp && parsedStsh && parsedFont && textChunkReference != chunkReferences.end())
   {
     input->seek(long(textChunkReference->offset), librevenge::RVNG_SEEK_SET);
+    // the spans of all the text blocks share the TEXT chunk, read at once
+    TextArena &textArena = m_collector->getTextArena();
+    const std::size_t textBase = textArena.read(input, textOffsetAccum);
+    const std::size_t textSize = textArena.size() - textBase;
     unsigned bytesRead = 0;
     auto currentTextSpan = spans.begin();
     auto currentTextPara = paras.begin();
@@ -1080,30 +1048,30 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
       MSPUB_DEBUG_MSG(("Parsing a text block.\n"));
       std::vector<TextParagraph> readParas;
       std::vector<TextSpan> readSpans;
-      std::vector<unsigned char> text;
+      unsigned spanStart = bytesRead;
       for (unsigned k = 0; k < textLengths[j] && currentTextPara != paras.end() && currentTextSpan != spans.end(); ++k)
       {
-        text.push_back(readU8(input));
-        text.push_back(readU8(input));
+        if (bytesRead + 2 > textSize)
+          throw EndOfStreamException();
         bytesRead += 2;
         if (bytesRead >= currentTextSpan->last - textChunkReference->offset)
         {
-          if (!text.empty())
+          if (bytesRead > spanStart)
           {
-            readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+            readSpans.push_back(textArena.getSpan(textBase + spanStart, bytesRead - spanStart, currentTextSpan->charStyle));
             MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
           }
           ++currentTextSpan;
-          text.clear();
+          spanStart = bytesRead;
         }
         if (bytesRead >= currentTextPara->last - textChunkReference->offset)
         {
-          if (!text.empty())
+          if (bytesRead > spanStart)
           {
-            readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+            readSpans.push_back(textArena.getSpan(textBase + spanStart, bytesRead - spanStart, currentTextSpan->charStyle));
             MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
           }
-          text.clear();
+          spanStart = bytesRead;
           if (!readSpans.empty())
           {
             readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyle));
@@ -1113,12 +1081,11 @@ bool MSPUBParser::parseQuill(librevenge::RVNGInputStream *input)
           readSpans.clear();
         }
       }
-      if (!text.empty() && currentTextSpan != spans.end())
+      if (bytesRead > spanStart && currentTextSpan != spans.end())
       {
-        readSpans.push_back(TextSpan(text, currentTextSpan->charStyle));
+        readSpans.push_back(textArena.getSpan(textBase + spanStart, bytesRead - spanStart, currentTextSpan->charStyle));
         MSPUB_DEBUG_MSG(("Saw text span %d in the current text paragraph.\n", (unsigned)readSpans.size()));
       }
-      text.clear();
       if (!readSpans.empty() && currentTextPara != paras.end())
       {
         readParas.push_back(TextParagraph(readSpans, currentTextPara->paraStyle));
@@ -1524,24 +1491,25 @@ int MSPUBParser::getColorIndex(librevenge::RVNGInputStream *input, const MSPUBBl
 bool MSPUBParser::parseEscher(librevenge::RVNGInputStream *input)
 {
   MSPUB_DEBUG_MSG(("MSPUBParser::parseEscher\n"));
-  EscherContainerInfo fakeroot;
-  fakeroot.initial = 0;
-  fakeroot.type = 0;
-  fakeroot.contentsOffset = static_cast<unsigned long>(input->tell());
-  fakeroot.contentsLength = static_cast<unsigned long>(-1); //FIXME: Get the actual length
-  EscherContainerInfo dg, dgg;
+  m_escherIndex.build(input);
+  unsigned dgg;
   //Note: this assumes that dgg comes before any dg with images.
-  if (findEscherContainer(input, fakeroot, dgg, OFFICE_ART_DGG_CONTAINER))
+  if (m_escherIndex.findChild(EscherIndex::ROOT, OFFICE_ART_DGG_CONTAINER, dgg))
   {
-    EscherContainerInfo bsc;
-    if (findEscherContainer(input, fakeroot, bsc, OFFICE_ART_B_STORE_CONTAINER))
+    unsigned bscId;
+    if (m_escherIndex.findChild(dgg, OFFICE_ART_B_STORE_CONTAINER, bscId))
     {
+      const EscherContainerInfo &bsc = m_escherIndex.get(bscId);
+      input->seek(long(bsc.contentsOffset), librevenge::RVNG_SEEK_SET);
+      ByteReader entries(input, bsc.contentsLength);
+      const unsigned long end = bsc.contentsOffset + bsc.contentsLength;
       unsigned short currentDelayIndex = 1;
-      while (stillReading(input, bsc.contentsOffset + bsc.contentsLength))
+      while (entries.stillReading(end))
       {
-        unsigned begin = unsigned(input->tell());
-        input->seek(long(begin + 10), librevenge::RVNG_SEEK_SET);
-        if (!(readU32(input) == 0 && readU32(input) == 0 && readU32(input) == 0 && readU32(input) == 0))
+        unsigned long begin = entries.tell();
+        if (!entries.seek(begin + 10) || entries.remaining() < 16)
+          break;
+        if (!(entries.readU32() == 0 && entries.readU32() == 0 && entries.readU32() == 0 && entries.readU32() == 0))
         {
           m_escherDelayIndices.push_back(currentDelayIndex++);
         }
@@ -1549,33 +1517,31 @@ bool MSPUBParser::parseEscher(librevenge::RVNGInputStream *input)
         {
           m_escherDelayIndices.push_back(-1);
         }
-        input->seek(long(begin + 44), librevenge::RVNG_SEEK_SET);
+        if (!entries.seek(begin + 44))
+          break;
       }
     }
-    input->seek(long(dgg.contentsOffset + dgg.contentsLength + getEscherElementTailLength(OFFICE_ART_DGG_CONTAINER)), librevenge::RVNG_SEEK_SET);
   }
-  while (findEscherContainer(input, fakeroot, dg, OFFICE_ART_DG_CONTAINER))
+  for (unsigned dg = m_escherIndex.firstChild(EscherIndex::ROOT); dg < m_escherIndex.childrenEnd(EscherIndex::ROOT); dg = m_escherIndex.nextSibling(dg))
   {
-    EscherContainerInfo spgr;
-    while (findEscherContainer(input, dg, spgr, OFFICE_ART_SPGR_CONTAINER))
+    if (m_escherIndex.get(dg).type != OFFICE_ART_DG_CONTAINER)
+      continue;
+    for (unsigned spgr = m_escherIndex.firstChild(dg); spgr < m_escherIndex.childrenEnd(dg); spgr = m_escherIndex.nextSibling(spgr))
     {
+      if (m_escherIndex.get(spgr).type != OFFICE_ART_SPGR_CONTAINER)
+        continue;
       Coordinate c1, c2;
       parseShapeGroup(input, spgr, c1, c2);
     }
-    input->seek(long(input->tell() + getEscherElementTailLength(OFFICE_ART_DG_CONTAINER)), librevenge::RVNG_SEEK_SET);
   }
   return true;
 }
 
-void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, const EscherContainerInfo &spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord)
+void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, unsigned spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord)
 {
-  EscherContainerInfo shapeOrGroup;
-  std::set<unsigned short> types;
-  types.insert(OFFICE_ART_SPGR_CONTAINER);
-  types.insert(OFFICE_ART_SP_CONTAINER);
-  while (findEscherContainerWithTypeInSet(input, spgr, shapeOrGroup, types))
+  for (unsigned shapeOrGroup = m_escherIndex.firstChild(spgr); shapeOrGroup < m_escherIndex.childrenEnd(spgr); shapeOrGroup = m_escherIndex.nextSibling(shapeOrGroup))
   {
-    switch (shapeOrGroup.type)
+    switch (m_escherIndex.get(shapeOrGroup).type)
     {
     case OFFICE_ART_SPGR_CONTAINER:
       m_collector->beginGroup();
@@ -1588,25 +1554,20 @@ void MSPUBParser::parseShapeGroup(librevenge::RVNGInputStream *input, const Esch
     default:
       break;
     }
-    input->seek(long(shapeOrGroup.contentsOffset + shapeOrGroup.contentsLength + getEscherElementTailLength(shapeOrGroup.type)), librevenge::RVNG_SEEK_SET);
   }
 }
 
-void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const EscherContainerInfo &sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord)
+void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, unsigned sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord)
 {
   Coordinate thisParentCoordinateSystem = parentCoordinateSystem;
   bool definesRelativeCoordinates = false;
-  EscherContainerInfo cData;
-  EscherContainerInfo cAnchor;
-  EscherContainerInfo cFopt;
-  EscherContainerInfo cTertiaryFopt;
-  EscherContainerInfo cFsp;
-  EscherContainerInfo cFspgr;
+  unsigned record;
   unsigned shapeFlags = 0;
   bool isGroupLeader = false;
   ShapeType st = RECTANGLE;
-  if (findEscherContainer(input, sp, cFspgr, OFFICE_ART_FSPGR))
+  if (m_escherIndex.findChild(sp, OFFICE_ART_FSPGR, record))
   {
+    const EscherContainerInfo &cFspgr = m_escherIndex.get(record);
     input->seek(long(cFspgr.contentsOffset), librevenge::RVNG_SEEK_SET);
     parentCoordinateSystem.m_xs = int(readU32(input));
     parentCoordinateSystem.m_ys = int(readU32(input));
@@ -1615,25 +1576,22 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
     parentCoordinateSystem.arrange();
     definesRelativeCoordinates = true;
   }
-  input->seek(long(sp.contentsOffset), librevenge::RVNG_SEEK_SET);
-  if (findEscherContainer(input, sp, cFsp, OFFICE_ART_FSP))
+  if (m_escherIndex.findChild(sp, OFFICE_ART_FSP, record))
   {
+    const EscherContainerInfo &cFsp = m_escherIndex.get(record);
     st = ShapeType(cFsp.initial >> 4);
-    std::map<unsigned short, unsigned> fspData = extractEscherValues(input, cFsp);
     input->seek(long(cFsp.contentsOffset + 4), librevenge::RVNG_SEEK_SET);
     shapeFlags = readU32(input);
     isGroupLeader = shapeFlags & SF_GROUP;
   }
-  input->seek(long(sp.contentsOffset), librevenge::RVNG_SEEK_SET);
-  if (findEscherContainer(input, sp, cData, OFFICE_ART_CLIENT_DATA))
+  if (m_escherIndex.findChild(sp, OFFICE_ART_CLIENT_DATA, record))
   {
-    std::map<unsigned short, unsigned> dataValues = extractEscherValues(input, cData);
+    FlatMap<unsigned short, unsigned> dataValues = extractEscherValues(input, m_escherIndex.get(record));
     unsigned *shapeSeqNum = getIfExists(dataValues, FIELDID_SHAPE_ID);
     if (shapeSeqNum)
     {
       m_collector->setShapeType(*shapeSeqNum, st);
       m_collector->setShapeFlip(*shapeSeqNum, shapeFlags & SF_FLIP_V, shapeFlags & SF_FLIP_H);
-      input->seek(long(sp.contentsOffset), librevenge::RVNG_SEEK_SET);
       if (isGroupLeader)
       {
         m_collector->setCurrentGroupSeqNum(*shapeSeqNum);
@@ -1642,23 +1600,20 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
       {
         m_collector->setShapeOrder(*shapeSeqNum);
       }
-      std::set<unsigned short> anchorTypes;
-      anchorTypes.insert(OFFICE_ART_CLIENT_ANCHOR);
-      anchorTypes.insert(OFFICE_ART_CHILD_ANCHOR);
+      unsigned anchor;
       bool foundAnchor;
-      if ((foundAnchor = findEscherContainerWithTypeInSet(input, sp, cAnchor, anchorTypes)) || isGroupLeader)
+      if ((foundAnchor = m_escherIndex.findChild(sp, OFFICE_ART_CLIENT_ANCHOR, OFFICE_ART_CHILD_ANCHOR, anchor)) || isGroupLeader)
       {
         bool rotated90 = false;
         MSPUB_DEBUG_MSG(("Found Escher data for %s of seqnum 0x%x\n", isGroupLeader ? "group" : "shape", *shapeSeqNum));
-        boost::optional<std::map<unsigned short, unsigned> > maybe_tertiaryFoptValues;
-        input->seek(long(sp.contentsOffset), librevenge::RVNG_SEEK_SET);
-        if (findEscherContainer(input, sp, cTertiaryFopt, OFFICE_ART_TERTIARY_FOPT))
+        boost::optional<FlatMap<unsigned short, unsigned> > maybe_tertiaryFoptValues;
+        if (m_escherIndex.findChild(sp, OFFICE_ART_TERTIARY_FOPT, record))
         {
-          maybe_tertiaryFoptValues = extractEscherValues(input, cTertiaryFopt);
+          maybe_tertiaryFoptValues = extractEscherValues(input, m_escherIndex.get(record));
         }
         if (bool(maybe_tertiaryFoptValues))
         {
-          const std::map<unsigned short, unsigned> &tertiaryFoptValues =
+          const FlatMap<unsigned short, unsigned> &tertiaryFoptValues =
             maybe_tertiaryFoptValues.get();
           const unsigned *ptr_pictureRecolor = getIfExists_const(tertiaryFoptValues,
                                                                  FIELDID_PICTURE_RECOLOR);
@@ -1668,10 +1623,9 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
                                                 ColorReference(*ptr_pictureRecolor));
           }
         }
-        input->seek(long(sp.contentsOffset), librevenge::RVNG_SEEK_SET);
-        if (findEscherContainer(input, sp, cFopt, OFFICE_ART_FOPT))
+        if (m_escherIndex.findChild(sp, OFFICE_ART_FOPT, record))
         {
-          FOPTValues foptValues = extractFOPTValues(input, cFopt);
+          FOPTValues foptValues = extractFOPTValues(input, m_escherIndex.get(record));
           unsigned *pxId = getIfExists(foptValues.m_scalarValues, FIELDID_PXID);
           if (pxId)
           {
@@ -1710,7 +1664,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
           bool useLine = lineExistsByFlagPointer(
                            ptr_lineFlags, ptr_geomFlags);
           bool skipIfNotBg = false;
-          std::shared_ptr<Fill> ptr_fill = getNewFill(foptValues.m_scalarValues, skipIfNotBg, foptValues.m_complexValues);
+          std::shared_ptr<Fill> ptr_fill = getNewFill(foptValues, skipIfNotBg);
           unsigned lineWidth = 0;
           if (useLine)
           {
@@ -1724,7 +1678,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
             {
               if (bool(maybe_tertiaryFoptValues))
               {
-                std::map<unsigned short, unsigned> &tertiaryFoptValues =
+                FlatMap<unsigned short, unsigned> &tertiaryFoptValues =
                   maybe_tertiaryFoptValues.get();
                 unsigned *ptr_tertiaryLineFlags = getIfExists(tertiaryFoptValues, FIELDID_LINE_STYLE_BOOL_PROPS);
                 if (lineExistsByFlagPointer(ptr_tertiaryLineFlags))
@@ -1841,7 +1795,7 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
 
           if (bool(maybe_tertiaryFoptValues))
           {
-            std::map<unsigned short, unsigned> &tertiaryFoptValues = maybe_tertiaryFoptValues.get();
+            FlatMap<unsigned short, unsigned> &tertiaryFoptValues = maybe_tertiaryFoptValues.get();
             unsigned *ptr_numColumns = getIfExists(tertiaryFoptValues, FIELDID_NUM_COLUMNS);
             if (ptr_numColumns)
             {
@@ -1912,20 +1866,20 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
             }
           }
 
-          const std::vector<unsigned char> vertexData = foptValues.m_complexValues[FIELDID_P_VERTICES];
+          const FOPTComplexValue vertexData = foptValues.getComplexValue(FIELDID_P_VERTICES);
           if (!vertexData.empty())
           {
             unsigned *p_geoRight = getIfExists(foptValues.m_scalarValues,
                                                FIELDID_GEO_RIGHT);
             unsigned *p_geoBottom = getIfExists(foptValues.m_scalarValues,
                                                 FIELDID_GEO_BOTTOM);
-            const std::vector<unsigned char> segmentData = foptValues.m_complexValues[FIELDID_P_SEGMENTS];
-            const std::vector<unsigned char> guideData = foptValues.m_complexValues[FIELDID_P_GUIDES];
+            const FOPTComplexValue segmentData = foptValues.getComplexValue(FIELDID_P_SEGMENTS);
+            const FOPTComplexValue guideData = foptValues.getComplexValue(FIELDID_P_GUIDES);
             m_collector->setShapeCustomPath(*shapeSeqNum, getDynamicCustomShape(vertexData, segmentData,
                                                                                 guideData, p_geoRight ? *p_geoRight : 21600,
                                                                                 p_geoBottom ? *p_geoBottom : 21600));
           }
-          const std::vector<unsigned char> wrapVertexData = foptValues.m_complexValues[FIELDID_P_WRAPPOLYGONVERTICES];
+          const FOPTComplexValue wrapVertexData = foptValues.getComplexValue(FIELDID_P_WRAPPOLYGONVERTICES);
           if (!wrapVertexData.empty())
           {
             std::vector<Vertex> ret = parseVertices(wrapVertexData);
@@ -1934,12 +1888,17 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
         }
         if (foundAnchor)
         {
+          const EscherContainerInfo &cAnchor = m_escherIndex.get(anchor);
           Coordinate absolute;
           if (cAnchor.type == OFFICE_ART_CLIENT_ANCHOR)
           {
-            std::map<unsigned short, unsigned> anchorData = extractEscherValues(input, cAnchor);
-            absolute = Coordinate(int(anchorData[FIELDID_XS]), int(anchorData[FIELDID_YS]),
-                                  int(anchorData[FIELDID_XE]), int(anchorData[FIELDID_YE]));
+            const FlatMap<unsigned short, unsigned> anchorData = extractEscherValues(input, cAnchor);
+            const unsigned *const xs = getIfExists_const(anchorData, FIELDID_XS);
+            const unsigned *const ys = getIfExists_const(anchorData, FIELDID_YS);
+            const unsigned *const xe = getIfExists_const(anchorData, FIELDID_XE);
+            const unsigned *const ye = getIfExists_const(anchorData, FIELDID_YE);
+            absolute = Coordinate(int(xs ? *xs : 0), int(ys ? *ys : 0),
+                                  int(xe ? *xe : 0), int(ye ? *ye : 0));
           }
           else if (cAnchor.type == OFFICE_ART_CHILD_ANCHOR)
           {
@@ -1988,9 +1947,9 @@ void MSPUBParser::parseEscherShape(librevenge::RVNGInputStream *input, const Esc
   }
 }
 
-std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, unsigned> &foptProperties,
-                                              bool &skipIfNotBg, std::map<unsigned short, std::vector<unsigned char> > &foptValues)
+std::shared_ptr<Fill> MSPUBParser::getNewFill(const FOPTValues &foptValues, bool &skipIfNotBg)
 {
+  const FlatMap<unsigned short, unsigned> &foptProperties = foptValues.m_scalarValues;
   FillType const *ptr_fillType = reinterpret_cast<FillType const *>(getIfExists_const(foptProperties, FIELDID_FILL_TYPE));
   FillType fillType = ptr_fillType ? *ptr_fillType : SOLID;
   switch (fillType)
@@ -2063,12 +2022,12 @@ std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, uns
     const unsigned *ptr_fillGrad = getIfExists_const(foptProperties, FIELDID_FILL_SHADE_COMPLEX);
     if (ptr_fillGrad)
     {
-      const std::vector<unsigned char> gradientData = foptValues[FIELDID_FILL_SHADE_COMPLEX];
+      const FOPTComplexValue gradientData = foptValues.getComplexValue(FIELDID_FILL_SHADE_COMPLEX);
       if (gradientData.size() > 6)
       {
         unsigned short numEntries = static_cast<unsigned short>(gradientData[0] | (gradientData[1] << 8));
         unsigned offs = 6;
-        for (unsigned i = 0; i < numEntries; ++i)
+        for (unsigned i = 0; i < numEntries && offs + 8 <= gradientData.size(); ++i)
         {
           unsigned color = gradientData[offs] | (unsigned(gradientData[offs + 1]) << 8) | (unsigned(gradientData[offs + 2]) << 16) | (unsigned(gradientData[offs + 3]) << 24);
           offs += 4;
@@ -2160,8 +2119,8 @@ std::shared_ptr<Fill> MSPUBParser::getNewFill(const std::map<unsigned short, uns
 }
 
 DynamicCustomShape MSPUBParser::getDynamicCustomShape(
-  const std::vector<unsigned char> &vertexData, const std::vector<unsigned char> &segmentData,
-  const std::vector<unsigned char> &guideData, unsigned geoWidth,
+  const FOPTComplexValue &vertexData, const FOPTComplexValue &segmentData,
+  const FOPTComplexValue &guideData, unsigned geoWidth,
   unsigned geoHeight)
 {
   DynamicCustomShape ret(geoWidth, geoHeight);
@@ -2172,7 +2131,7 @@ DynamicCustomShape MSPUBParser::getDynamicCustomShape(
 }
 
 std::vector<unsigned short> MSPUBParser::parseSegments(
-  const std::vector<unsigned char> &segmentData)
+  const FOPTComplexValue &segmentData)
 {
   std::vector<unsigned short> ret;
   if (segmentData.size() < 6)
@@ -2195,7 +2154,7 @@ std::vector<unsigned short> MSPUBParser::parseSegments(
 }
 
 std::vector<Calculation> MSPUBParser::parseGuides(
-  const std::vector<unsigned char> &/* guideData */)
+  const FOPTComplexValue &/* guideData */)
 {
   std::vector<Calculation> ret;
 
@@ -2205,7 +2164,7 @@ std::vector<Calculation> MSPUBParser::parseGuides(
 }
 
 std::vector<Vertex> MSPUBParser::parseVertices(
-  const std::vector<unsigned char> &vertexData)
+  const FOPTComplexValue &vertexData)
 {
   std::vector<Vertex> ret;
   if (vertexData.size() < 6)
@@ -2260,18 +2219,6 @@ std::vector<Vertex> MSPUBParser::parseVertices(
   return ret;
 }
 
-unsigned MSPUBParser::getEscherElementTailLength(unsigned short type)
-{
-  switch (type)
-  {
-  case OFFICE_ART_DGG_CONTAINER:
-  case OFFICE_ART_DG_CONTAINER:
-    return 4;
-  default:
-    return 0;
-  }
-}
-
 unsigned MSPUBParser::getEscherElementAdditionalHeaderLength(unsigned short type)
 {
   switch (type)
@@ -2284,51 +2231,26 @@ unsigned MSPUBParser::getEscherElementAdditionalHeaderLength(unsigned short type
   }
 }
 
-bool MSPUBParser::findEscherContainerWithTypeInSet(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, std::set<unsigned short> types)
-{
-  while (stillReading(input, parent.contentsOffset + parent.contentsLength))
-  {
-    EscherContainerInfo next = parseEscherContainer(input);
-    if (types.find(next.type) != types.end())
-    {
-      out = next;
-      return true;
-    }
-    input->seek(long(next.contentsOffset + next.contentsLength + getEscherElementTailLength(next.type)), librevenge::RVNG_SEEK_SET);
-  }
-  return false;
-}
-
-bool MSPUBParser::findEscherContainer(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, unsigned short desiredType)
-{
-  MSPUB_DEBUG_MSG(("At offset 0x%lx, attempting to find escher container of type 0x%x\n", input->tell(), desiredType));
-  while (stillReading(input, parent.contentsOffset + parent.contentsLength))
-  {
-    EscherContainerInfo next = parseEscherContainer(input);
-    if (next.type == desiredType)
-    {
-      out = next;
-      return true;
-    }
-    input->seek(long(next.contentsOffset + next.contentsLength + getEscherElementTailLength(next.type)), librevenge::RVNG_SEEK_SET);
-  }
-  return false;
-}
-
 FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
 {
   FOPTValues ret;
   input->seek(long(record.contentsOffset), librevenge::RVNG_SEEK_SET);
+  const unsigned long end = record.contentsOffset + record.contentsLength;
+  ByteReader reader(input, record.contentsLength);
+  // keep the record, the complex values are views on it
+  ret.m_data.assign(reader.current(), reader.current() + reader.remaining());
+  reader = ByteReader(ret.m_data.data(), ret.m_data.size(), record.contentsOffset);
   unsigned short numValues = static_cast<unsigned short>(record.initial >> 4);
+  ret.m_scalarValues.reserve(numValues);
   std::vector<unsigned short> complexIds;
   for (unsigned short i = 0; i < numValues; ++i)
   {
-    if (!stillReading(input, record.contentsOffset + record.contentsLength))
+    if (!reader.stillReading(end))
     {
       break;
     }
-    unsigned short id = readU16(input);
-    unsigned value  = readU32(input);
+    unsigned short id = reader.readU16();
+    unsigned value  = reader.readU32();
     ret.m_scalarValues[id] = value;
     bool complex = id & 0x8000;
     if (complex)
@@ -2338,7 +2260,7 @@ FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, co
   }
   for (unsigned short id : complexIds)
   {
-    if (!stillReading(input, record.contentsOffset + record.contentsLength))
+    if (!reader.stillReading(end))
     {
       break;
     }
@@ -2347,22 +2269,35 @@ FOPTValues MSPUBParser::extractFOPTValues(librevenge::RVNGInputStream *input, co
     {
       continue;
     }
-    unsigned short numEntries = readU16(input);
-    input->seek(2, librevenge::RVNG_SEEK_CUR);
-    unsigned short entryLength = readU16(input);
+    if (reader.remaining() < 6)
+    {
+      break;
+    }
+    const unsigned long start = reader.tell();
+    unsigned short numEntries = reader.readU16();
+    reader.skip(2);
+    unsigned short entryLength = reader.readU16();
     if (entryLength == 0xFFF0)
     {
       entryLength = 4;
     }
-    input->seek(-6, librevenge::RVNG_SEEK_CUR);
-    readNBytes(input, static_cast<unsigned long>(entryLength) * numEntries + 6, ret.m_complexValues[id]);
+    reader.seek(start);
+    const unsigned long complexLength = static_cast<unsigned long>(entryLength) * numEntries + 6;
+    if (complexLength > reader.remaining())
+    {
+      // give up on a truncated value
+      break;
+    }
+    ret.m_complexValues[id] = FOPTComplexValue(reader.current(), complexLength);
+    reader.skip(complexLength);
   }
+  input->seek(long(reader.tell()), librevenge::RVNG_SEEK_SET);
   return ret;
 }
 
-std::map<unsigned short, unsigned> MSPUBParser::extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
+FlatMap<unsigned short, unsigned> MSPUBParser::extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record)
 {
-  std::map<unsigned short, unsigned> ret;
+  FlatMap<unsigned short, unsigned> ret;
   input->seek(long(record.contentsOffset + getEscherElementAdditionalHeaderLength(record.type)), librevenge::RVNG_SEEK_SET);
   while (stillReading(input, record.contentsOffset + record.contentsLength))
   {
@@ -2412,25 +2347,23 @@ bool MSPUBParser::parseContentChunkReference(librevenge::RVNGInputStream *input,
   }
   if (seenType && seenOffset) //FIXME: What if there is an offset, but not a type? Should we still set the end of the preceding chunk to that offset?
   {
+    const ContentChunkReference chunk(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0);
     if (type == PAGE)
     {
       MSPUB_DEBUG_MSG(("page chunk: offset 0x%lx, seqnum 0x%x\n", offset, m_lastSeenSeqNum));
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_pageChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_pageChunkIndices.push_back(m_contentChunks.push_back(chunk));
       return true;
     }
     else if (type == DOCUMENT)
     {
       MSPUB_DEBUG_MSG(("document chunk: offset 0x%lx, seqnum 0x%x\n", offset, m_lastSeenSeqNum));
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_documentChunkIndex = unsigned(m_contentChunks.size() - 1);
+      m_documentChunkIndex = m_contentChunks.push_back(chunk);
       return true;
     }
     else if (type == SHAPE || type == ALTSHAPE || type == GROUP || type == TABLE || type == LOGO)
     {
       MSPUB_DEBUG_MSG(("shape chunk: offset 0x%lx, seqnum 0x%x, parent seqnum: 0x%x\n", offset, m_lastSeenSeqNum, parentSeqNum));
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_shapeChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_shapeChunkIndices.push_back(m_contentChunks.push_back(chunk));
       if (type == ALTSHAPE)
       {
         m_alternateShapeSeqNums.push_back(m_lastSeenSeqNum);
@@ -2439,34 +2372,25 @@ bool MSPUBParser::parseContentChunkReference(librevenge::RVNGInputStream *input,
     }
     else if (type == CELLS)
     {
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_cellsChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_contentChunks.push_back(chunk);
       return true;
     }
     else if (type == PALETTE)
     {
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_paletteChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_paletteChunkIndices.push_back(m_contentChunks.push_back(chunk));
       return true;
     }
     else if (type == BORDER_ART)
     {
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0,
-                                                      unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-      m_borderArtChunkIndices.push_back(
-        unsigned(m_contentChunks.size() - 1));
+      m_borderArtChunkIndices.push_back(m_contentChunks.push_back(chunk));
       return true;
     }
     else if (type == FONT)
     {
-      m_contentChunks.push_back(ContentChunkReference(type, offset, 0,
-                                                      unsigned(m_lastSeenSeqNum),
-                                                      seenParentSeqNum ? parentSeqNum : 0));
-      m_fontChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+      m_fontChunkIndices.push_back(m_contentChunks.push_back(chunk));
       return true;
     }
-    m_contentChunks.push_back(ContentChunkReference(type, offset, 0, unsigned(m_lastSeenSeqNum), seenParentSeqNum ? parentSeqNum : 0));
-    m_unknownChunkIndices.push_back(unsigned(m_contentChunks.size() - 1));
+    m_unknownChunkIndices.push_back(m_contentChunks.push_back(chunk));
   }
   return false;
 }
@@ -2495,14 +2419,17 @@ MSPUBBlockInfo MSPUBParser::parseBlock(librevenge::RVNGInputStream *input, bool
 {
   MSPUBBlockInfo info;
   info.startPosition = static_cast<unsigned long>(input->tell());
-  info.id = readU8(input);
-  info.type = readU8(input);
-  info.dataOffset = static_cast<unsigned long>(input->tell());
+  // id, type and at most 4 bytes of integral data or of variable length
+  ByteReader header(input, 6);
+  info.id = header.readU8();
+  info.type = header.readU8();
+  info.dataOffset = header.tell();
   int len = getBlockDataLength(info.type);
   bool varLen = len < 0;
   if (varLen)
   {
-    info.dataLength = readU32(input);
+    info.dataLength = header.readU32();
+    input->seek(long(header.tell()), librevenge::RVNG_SEEK_SET);
     if (isBlockDataString(info.type))
     {
       info.stringData = std::vector<unsigned char>();
@@ -2520,23 +2447,19 @@ MSPUBBlockInfo MSPUBParser::parseBlock(librevenge::RVNGInputStream *input, bool
     switch (info.dataLength)
     {
     case 1:
-      info.data = readU8(input);
+      info.data = header.readU8();
       break;
     case 2:
-      info.data = readU16(input);
+      info.data = header.readU16();
       break;
     case 4:
-      info.data = readU32(input);
+      info.data = header.readU32();
       break;
-    case 8:
-    case 16:
-    case 24:
-      //FIXME: Not doing anything with this data for now.
-      skipBlock(input, info);
-      MSPUB_FALLTHROUGH;
     default:
+      //FIXME: Not doing anything with the data of 8, 16 and 24 bytes blocks for now.
       info.data = 0;
     }
+    input->seek(long(info.dataOffset + info.dataLength), librevenge::RVNG_SEEK_SET);
   }
   MSPUB_DEBUG_MSG(("parseBlock dataOffset 0x%lx, id 0x%x, type 0x%x, dataLength 0x%lx, integral data 0x%x\n", info.dataOffset, info.id, info.type, info.dataLength, info.data));
   return info;
@@ -2597,23 +2520,8 @@ void MSPUBParser::parsePaletteEntry(librevenge::RVNGInputStream *input, MSPUBBlo
 
 bool MSPUBParser::parseMetaData()
 {
-  m_input->seek(0, librevenge::RVNG_SEEK_SET);
   MSPUBMetaData metaData;
-
-  std::unique_ptr<librevenge::RVNGInputStream> sumaryInfo(m_input->getSubStreamByName("\x05SummaryInformation"));
-  if (sumaryInfo)
-  {
-    metaData.parse(sumaryInfo.get());
-  }
-
-  std::unique_ptr<librevenge::RVNGInputStream> docSumaryInfo(m_input->getSubStreamByName("\005DocumentSummaryInformation"));
-  if (docSumaryInfo)
-  {
-    metaData.parse(docSumaryInfo.get());
-  }
-
-  m_input->seek(0, librevenge::RVNG_SEEK_SET);
-  metaData.parseTimes(m_input);
+  metaData.parseDocument(m_subStreams);
   m_collector->collectMetaData(metaData.getMetaData());
 
   return true;
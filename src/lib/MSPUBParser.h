@@ -20,6 +20,9 @@
 
 #include <librevenge/librevenge.h>
 
+#include "ChunkDirectory.h"
+#include "EscherIndex.h"
+#include "FlatMap.h"
 #include "MSPUBTypes.h"
 #include "PolygonUtils.h"
 
@@ -28,46 +31,63 @@ namespace libmspub
 
 class Fill;
 class MSPUBCollector;
+class SubStreamCache;
 
 struct Coordinate;
 
-class FindBySeqNum
+//! A view on the bytes of a complex property of a FOPT record
+struct FOPTComplexValue
 {
-  unsigned seqNum;
-public:
-  FindBySeqNum(unsigned sn) : seqNum(sn) { }
-  bool operator()(const libmspub::ContentChunkReference &ref)
+  FOPTComplexValue() : m_data(nullptr), m_size(0) { }
+  FOPTComplexValue(const unsigned char *data, unsigned long size) : m_data(data), m_size(size) { }
+  bool empty() const
   {
-    return ref.seqNum == seqNum;
+    return m_size == 0;
   }
-};
-
-class FindByParentSeqNum
-{
-  unsigned seqNum;
-public:
-  FindByParentSeqNum(unsigned sn) : seqNum(sn) { }
-  bool operator()(const libmspub::ContentChunkReference &ref)
+  unsigned long size() const
   {
-    return ref.parentSeqNum == seqNum;
+    return m_size;
   }
+  unsigned char operator[](unsigned long i) const
+  {
+    return m_data[i];
+  }
+  const unsigned char *m_data;
+  unsigned long m_size;
 };
 
+/** The properties of a FOPT record.
+
+    The complex values point into m_data, the contents of the record, so
+    this can be moved but not copied.
+  */
 struct FOPTValues
 {
-  std::map<unsigned short, unsigned> m_scalarValues;
-  std::map<unsigned short, std::vector<unsigned char> > m_complexValues;
-  FOPTValues() : m_scalarValues(), m_complexValues()
+  FlatMap<unsigned short, unsigned> m_scalarValues;
+  FlatMap<unsigned short, FOPTComplexValue> m_complexValues;
+  std::vector<unsigned char> m_data;
+  FOPTValues() : m_scalarValues(), m_complexValues(), m_data()
+  {
+  }
+  FOPTValues(FOPTValues &&) = default;
+  FOPTValues(const FOPTValues &) = delete;
+  FOPTValues &operator=(const FOPTValues &) = delete;
+  //! Returns the complex value id, or an empty one.
+  FOPTComplexValue getComplexValue(unsigned short id) const
   {
+    auto it = m_complexValues.find(id);
+    return it == m_complexValues.end() ? FOPTComplexValue() : it->second;
   }
 };
 
 class MSPUBParser
 {
 public:
-  explicit MSPUBParser(librevenge::RVNGInputStream *input, MSPUBCollector *collector);
+  explicit MSPUBParser(SubStreamCache &subStreams, MSPUBCollector *collector);
   virtual ~MSPUBParser();
   virtual bool parse();
+  //! Only reads the document settings and the page lists, without calling go
+  bool probe();
 protected:
   virtual unsigned getColorIndexByQuillEntry(unsigned entry);
 
@@ -116,41 +136,36 @@ protected:
   void parseColors(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
   void parseFonts(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
   void parseDefaultStyle(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  void parseShapeGroup(librevenge::RVNGInputStream *input, const EscherContainerInfo &spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord);
+  void parseShapeGroup(librevenge::RVNGInputStream *input, unsigned spgr, Coordinate parentCoordinateSystem, Coordinate parentGroupAbsoluteCoord);
   void skipBlock(librevenge::RVNGInputStream *input, MSPUBBlockInfo block);
-  void parseEscherShape(librevenge::RVNGInputStream *input, const EscherContainerInfo &sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord);
-  bool findEscherContainer(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, unsigned short type);
-  bool findEscherContainerWithTypeInSet(librevenge::RVNGInputStream *input, const EscherContainerInfo &parent, EscherContainerInfo &out, std::set<unsigned short> types);
-  std::map<unsigned short, unsigned> extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record);
+  void parseEscherShape(librevenge::RVNGInputStream *input, unsigned sp, Coordinate &parentCoordinateSystem, Coordinate &parentGroupAbsoluteCoord);
+  FlatMap<unsigned short, unsigned> extractEscherValues(librevenge::RVNGInputStream *input, const EscherContainerInfo &record);
   FOPTValues extractFOPTValues(librevenge::RVNGInputStream *input,
                                const libmspub::EscherContainerInfo &record);
   std::vector<TextSpanReference> parseCharacterStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
   std::vector<TextParagraphReference> parseParagraphStyles(librevenge::RVNGInputStream *input, const QuillChunkReference &chunk);
-  std::vector<Calculation> parseGuides(const std::vector<unsigned char>
-                                       &guideData);
-  std::vector<Vertex> parseVertices(const std::vector<unsigned char>
-                                    &vertexData);
+  std::vector<Calculation> parseGuides(const FOPTComplexValue &guideData);
+  std::vector<Vertex> parseVertices(const FOPTComplexValue &vertexData);
   std::vector<unsigned> parseTableCellDefinitions(librevenge::RVNGInputStream *input,
                                                   const QuillChunkReference &chunk);
-  std::vector<unsigned short> parseSegments(
-    const std::vector<unsigned char> &segmentData);
+  std::vector<unsigned short> parseSegments(const FOPTComplexValue &segmentData);
   DynamicCustomShape getDynamicCustomShape(
-    const std::vector<unsigned char> &vertexData,
-    const std::vector<unsigned char> &segmentData,
-    const std::vector<unsigned char> &guideData,
+    const FOPTComplexValue &vertexData,
+    const FOPTComplexValue &segmentData,
+    const FOPTComplexValue &guideData,
     unsigned geoWidth, unsigned geoHeight);
   int getColorIndex(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &info);
   unsigned getFontIndex(librevenge::RVNGInputStream *input, const MSPUBBlockInfo &info);
   CharacterStyle getCharacterStyle(librevenge::RVNGInputStream *input);
   ParagraphStyle getParagraphStyle(librevenge::RVNGInputStream *input);
-  std::shared_ptr<Fill> getNewFill(const std::map<unsigned short, unsigned> &foptProperties, bool &skipIfNotBg, std::map<unsigned short, std::vector<unsigned char> > &foptValues);
+  std::shared_ptr<Fill> getNewFill(const FOPTValues &foptValues, bool &skipIfNotBg);
 
   librevenge::RVNGInputStream *m_input;
+  SubStreamCache &m_subStreams;
   unsigned m_length;
   MSPUBCollector *m_collector;
   std::vector<MSPUBBlockInfo> m_blockInfo;
-  std::vector<ContentChunkReference> m_contentChunks;
-  std::vector<unsigned> m_cellsChunkIndices;
+  ChunkDirectory m_contentChunks;
   std::vector<unsigned> m_pageChunkIndices;
   std::vector<unsigned> m_shapeChunkIndices;
   std::vector<unsigned> m_paletteChunkIndices;
@@ -162,11 +177,13 @@ protected:
   unsigned m_lastAddedImage;
   std::vector<int> m_alternateShapeSeqNums;
   std::vector<int> m_escherDelayIndices;
+  EscherIndex m_escherIndex;
+  //! true when only the document settings and the page lists are wanted
+  bool m_probing;
 
   static short getBlockDataLength(unsigned type);
   static bool isBlockDataString(unsigned type);
   static PageType getPageTypeBySeqNum(unsigned seqNum);
-  static unsigned getEscherElementTailLength(unsigned short type);
   static unsigned getEscherElementAdditionalHeaderLength(unsigned short type);
   static ImgType imgTypeByBlipType(unsigned short type);
   static int getStartOffset(ImgType type, unsigned short initial);
@@ -22,19 +22,18 @@
 #include "MSPUBMetaData.h"
 #include "OLEParser.h"
 #include "ShapeType.h"
+#include "SubStreamCache.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
 {
 
-MSPUBParser2k::MSPUBParser2k(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
-  : MSPUBParser(input, collector)
+MSPUBParser2k::MSPUBParser2k(SubStreamCache &subStreams, MSPUBCollector *collector)
+  : MSPUBParser(subStreams, collector)
   , m_imageDataChunkIndices()
   , m_oleDataChunkIndices()
   , m_specialPaperChunkIndex()
   , m_quillColorEntries()
-  , m_fileIdToChunkId()
-  , m_chunkChildIndicesById()
   , m_shapesAlreadySend()
   , m_version(5) // assume publisher 98
   , m_isBanner(false)
@@ -61,10 +60,10 @@ MSPUBParser2k::~MSPUBParser2k()
 
 bool MSPUBParser2k::getChunkReference(unsigned seqNum, ContentChunkReference &chunk) const
 {
-  auto it=m_fileIdToChunkId.find(seqNum);
-  if (it==m_fileIdToChunkId.end())
+  const ContentChunkReference *const found = m_contentChunks.find(seqNum);
+  if (!found)
     return false;
-  chunk=m_contentChunks.at(it->second);
+  chunk=*found;
   return true;
 }
 
@@ -453,8 +452,6 @@ bool MSPUBParser2k::parseContents(librevenge::RVNGInputStream *input)
     unsigned short typeMarker = readU16(input);
     input->seek(offset, librevenge::RVNG_SEEK_SET);
     unsigned const chunkId=unsigned(m_contentChunks.size());
-    m_chunkChildIndicesById[parent].push_back(chunkId);
-    m_fileIdToChunkId[id]=chunkId;
     switch (typeMarker)
     {
     case 0x0014:
@@ -578,6 +575,8 @@ bool MSPUBParser2k::parseContents(librevenge::RVNGInputStream *input)
   input->seek(long(docChunk.offset)+2, librevenge::RVNG_SEEK_SET);
   int docChunkSize=int(readU8(input));
   updateVersion(docChunkSize, contentVersion);
+  if (m_probing)
+    return parseDocument(input);
 
   // parse the text bullet and the text content
   if (bulletChunkIndex)
@@ -731,7 +730,7 @@ bool MSPUBParser2k::parseDocument(librevenge::RVNGInputStream *input)
           if (numPages<extra) break;
           unsigned page=unsigned(numPages-extra);
           if (page<3) break; // keep at least layout, background, first page
-          if (m_chunkChildIndicesById.find(pages[page])!=m_chunkChildIndicesById.end())
+          if (m_contentChunks.getChildIndices(pages[page]))
           {
             MSPUB_DEBUG_MSG(("MSPUBParser2k::parseDocument: find a not empty extra page=%d\n", int(page)));
             continue; // this page contain some data, unsure if we need to keep it
@@ -768,6 +767,8 @@ bool MSPUBParser2k::parseDocument(librevenge::RVNGInputStream *input)
 
 bool MSPUBParser2k::parsePage(librevenge::RVNGInputStream *input, unsigned seqNum)
 {
+  if (m_probing)
+    return true;
   ContentChunkReference chunk;
   if (!getChunkReference(seqNum, chunk))
   {
@@ -1072,20 +1073,12 @@ bool MSPUBParser2k::parse2kShapeChunk(const ContentChunkReference &chunk, librev
   if (topLevelCall && m_version>5)
   {
     // ignore non top level shapes
-    int i_page = -1;
-    for (unsigned int pageIndex : m_pageChunkIndices)
-    {
-      if (m_contentChunks.at(pageIndex).seqNum == chunk.parentSeqNum)
-      {
-        i_page = int(pageIndex);
-        break;
-      }
-    }
-    if (i_page == -1)
+    const ContentChunkReference *const pageChunk = m_contentChunks.find(chunk.parentSeqNum);
+    if (!pageChunk || pageChunk->type != PAGE)
     {
       return false;
     }
-    if (getPageTypeBySeqNum(m_contentChunks[size_t(i_page)].seqNum) != NORMAL)
+    if (getPageTypeBySeqNum(pageChunk->seqNum) != NORMAL)
     {
       return false;
     }
@@ -1536,11 +1529,10 @@ bool MSPUBParser2k::parseGroup(librevenge::RVNGInputStream *input, unsigned seqN
   }
   else
   {
-    const std::map<unsigned, std::vector<unsigned> >::const_iterator it = m_chunkChildIndicesById.find(seqNum);
-    if (it != m_chunkChildIndicesById.end())
+    const std::vector<unsigned> *const chunkChildIndices = m_contentChunks.getChildIndices(seqNum);
+    if (chunkChildIndices)
     {
-      const std::vector<unsigned> &chunkChildIndices = it->second;
-      for (unsigned int chunkChildIndex : chunkChildIndices)
+      for (unsigned int chunkChildIndex : *chunkChildIndices)
       {
         const ContentChunkReference &childChunk = m_contentChunks.at(chunkChildIndex);
         retVal = retVal && parse2kShapeChunk(childChunk, input, page, false);
@@ -1630,24 +1622,24 @@ void MSPUBParser2k::parseShapeLine(librevenge::RVNGInputStream *input, bool isRe
 
 bool MSPUBParser2k::parse()
 {
-  std::unique_ptr<librevenge::RVNGInputStream> contents(m_input->getSubStreamByName("Contents"));
+  librevenge::RVNGInputStream *contents = m_subStreams.getSubStream("Contents");
   if (!contents)
   {
     MSPUB_DEBUG_MSG(("Couldn't get contents stream.\n"));
     return false;
   }
-  if (!parseContents(contents.get()))
+  if (!parseContents(contents))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse contents stream.\n"));
     return false;
   }
-  std::unique_ptr<librevenge::RVNGInputStream> quill(m_input->getSubStreamByName("Quill/QuillSub/CONTENTS"));
+  librevenge::RVNGInputStream *quill = m_subStreams.getSubStream("Quill/QuillSub/CONTENTS");
   if (!quill)
   {
     MSPUB_DEBUG_MSG(("Couldn't get quill stream.\n"));
     return false;
   }
-  if (!parseQuill(quill.get()))
+  if (!parseQuill(quill))
   {
     MSPUB_DEBUG_MSG(("Couldn't parse quill stream.\n"));
     return false;
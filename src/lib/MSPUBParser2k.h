@@ -98,8 +98,6 @@ private:
   std::vector<unsigned> m_oleDataChunkIndices;
   boost::optional<unsigned> m_specialPaperChunkIndex;
   std::vector<unsigned> m_quillColorEntries;
-  std::map<unsigned, unsigned> m_fileIdToChunkId;
-  std::map<unsigned, std::vector<unsigned> > m_chunkChildIndicesById;
   std::set<unsigned> m_shapesAlreadySend;
 
 protected:
@@ -153,7 +151,7 @@ protected:
   unsigned getShapeFillColorOffset() const;
   unsigned getTextIdOffset() const;
 public:
-  explicit MSPUBParser2k(librevenge::RVNGInputStream *input, MSPUBCollector *collector);
+  explicit MSPUBParser2k(SubStreamCache &subStreams, MSPUBCollector *collector);
   bool parse() override;
   ~MSPUBParser2k() override;
 };
@@ -15,8 +15,10 @@
 #include <map>
 #include <memory>
 
+#include "ByteReader.h"
 #include "MSPUBCollector.h"
 #include "MSPUBTypes.h"
+#include "TextArena.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
@@ -119,8 +121,8 @@ struct MSPubParser91Data
   std::map<unsigned,BlockInfo91> m_idToBlockMap;
 };
 
-MSPUBParser91::MSPUBParser91(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
-  : MSPUBParser(input, collector)
+MSPUBParser91::MSPUBParser91(SubStreamCache &subStreams, MSPUBCollector *collector)
+  : MSPUBParser(subStreams, collector)
   , m_data(new MSPubParser91Data)
 {
   m_collector->useEncodingHeuristic();
@@ -172,7 +174,7 @@ bool MSPUBParser91::parseContents(librevenge::RVNGInputStream *input)
     MSPUB_DEBUG_MSG(("MSPUBParser91::parseContents: can not find main zone.\n"));
     return false;
   }
-  if (offsets[0] && input->seek(offsets[0], librevenge::RVNG_SEEK_SET)==0)
+  if (offsets[0] && !m_probing && input->seek(offsets[0], librevenge::RVNG_SEEK_SET)==0)
     parseContentsTextIfNecessary(input);
   if (input->seek(offsets[1], librevenge::RVNG_SEEK_SET)!=0)
   {
@@ -186,14 +188,17 @@ bool MSPUBParser91::parseContents(librevenge::RVNGInputStream *input)
     return false;
   }
   parsePageIds(input);
-  if (input->seek(offsets[5], librevenge::RVNG_SEEK_SET)!=0)
+  if (!m_probing)
   {
-    MSPUB_DEBUG_MSG(("MSPUBParser91::parseContents: can not find the font offset.\n"));
-    return false;
+    if (input->seek(offsets[5], librevenge::RVNG_SEEK_SET)!=0)
+    {
+      MSPUB_DEBUG_MSG(("MSPUBParser91::parseContents: can not find the font offset.\n"));
+      return false;
+    }
+    parseFonts(input);
+    if (offsets[6] && input->seek(offsets[6], librevenge::RVNG_SEEK_SET)==0)
+      parseBorderArts(input);
   }
-  parseFonts(input);
-  if (offsets[6] && input->seek(offsets[6], librevenge::RVNG_SEEK_SET)==0)
-    parseBorderArts(input);
 
   if (input->seek(offsets[4], librevenge::RVNG_SEEK_SET)!=0)
   {
@@ -218,6 +223,8 @@ bool MSPUBParser91::parseContents(librevenge::RVNGInputStream *input)
       m_collector->designateMasterPage(masterId);
       for (auto const &id : m_data->m_pagesId)
         m_collector->setMasterPage(unsigned(id), masterId);
+      if (m_probing)
+        return true;
 
       m_collector->setShapePage(masterId,masterId);
       m_collector->beginGroup();
@@ -226,6 +233,8 @@ bool MSPUBParser91::parseContents(librevenge::RVNGInputStream *input)
       m_collector->endGroup();
     }
   }
+  if (m_probing)
+    return true;
 
   for (auto const &id : m_data->m_pagesId)
   {
@@ -297,6 +306,7 @@ void MSPUBParser91::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
         continue;
       }
       std::vector<unsigned char> spanChars;
+      TextArena &textArena = m_collector->getTextArena();
       spanChars.reserve(textLimits[i+1]-textLimits[i]);
       input->seek(textStart+textLimits[i], librevenge::RVNG_SEEK_SET);
       std::vector<TextParagraph> shapeParas;
@@ -319,7 +329,7 @@ void MSPUBParser91::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
         {
           if (!spanChars.empty())
           {
-            paraSpans.push_back(TextSpan(spanChars,charStyle));
+            paraSpans.push_back(textArena.append(spanChars,charStyle));
             spanChars.clear();
           }
           if (cIt->second<spanStyles.size())
@@ -330,7 +340,7 @@ void MSPUBParser91::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
         {
           if (!spanChars.empty())
           {
-            paraSpans.push_back(TextSpan(spanChars,charStyle));
+            paraSpans.push_back(textArena.append(spanChars,charStyle));
             spanChars.clear();
           }
           if (!paraSpans.empty()||(p+1!=textLimits[i+1] && oldParaPos>=actPos-3)) // 0c0d0a is an empty line
@@ -363,10 +373,10 @@ void MSPUBParser91::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
             ++p;
             if (!spanChars.empty())
             {
-              paraSpans.push_back(TextSpan(spanChars,charStyle));
+              paraSpans.push_back(textArena.append(spanChars,charStyle));
               spanChars.clear();
             }
-            TextSpan pageSpan(spanChars,charStyle);
+            TextSpan pageSpan = textArena.append(spanChars,charStyle);
             pageSpan.field=Field(Field::PageNumber);
             paraSpans.push_back(pageSpan);
           }
@@ -386,7 +396,7 @@ void MSPUBParser91::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
         }
       }
       if (!spanChars.empty())
-        paraSpans.push_back(TextSpan(spanChars,charStyle));
+        paraSpans.push_back(textArena.append(spanChars,charStyle));
       if (!paraSpans.empty())
         shapeParas.push_back(TextParagraph(paraSpans, paraStyle));
       m_collector->addTextString(shapeParas, zId);
@@ -657,16 +667,17 @@ bool MSPUBParser91::parseBlockInfos(librevenge::RVNGInputStream *input)
 {
   unsigned numBlocks = readU16(input);
   input->seek(2, librevenge::RVNG_SEEK_CUR); // skip max bloc id
+  ByteReader blocks(input, 10*static_cast<unsigned long>(numBlocks));
   auto &mainIdToBlockMap=m_data->m_idToBlockMap;
   std::vector<BlockInfo91> otherBlocks;
   for (unsigned i = 0; i < numBlocks; ++i)
   {
     BlockInfo91 block;
-    block.m_id=readU16(input);
-    block.m_parentId=int(readS16(input));
-    block.m_offset = readU16(input);
-    block.m_data=int(readS16(input));
-    block.m_flags=int(readU16(input));
+    block.m_id=blocks.readU16();
+    block.m_parentId=int(blocks.readS16());
+    block.m_offset = blocks.readU16();
+    block.m_data=int(blocks.readS16());
+    block.m_flags=int(blocks.readU16());
     if (((block.m_flags>>8)&0x8f)==0x81)
     {
       if (mainIdToBlockMap.find(block.m_id)!=mainIdToBlockMap.end())
@@ -679,6 +690,7 @@ bool MSPUBParser91::parseBlockInfos(librevenge::RVNGInputStream *input)
     else
       otherBlocks.push_back(block);
   }
+  input->seek(long(blocks.tell()), librevenge::RVNG_SEEK_SET);
   for (auto bl : otherBlocks)
   {
     auto pIt=mainIdToBlockMap.find(unsigned(bl.m_parentId));
@@ -27,7 +27,7 @@ struct MSPubParser91Data;
 class MSPUBParser91 final : public MSPUBParser
 {
 public:
-  MSPUBParser91(librevenge::RVNGInputStream *input, MSPUBCollector *collector);
+  MSPUBParser91(SubStreamCache &subStreams, MSPUBCollector *collector);
   bool parse() final;
 protected:
   bool parseContents(librevenge::RVNGInputStream *input) final;
@@ -15,16 +15,19 @@
 #include <memory>
 #include <utility>
 
+#include "ByteReader.h"
 #include "MSPUBCollector.h"
 #include "MSPUBTypes.h"
+#include "SubStreamCache.h"
 #include "TableInfo.h"
+#include "TextArena.h"
 #include "libmspub_utils.h"
 
 namespace libmspub
 {
 
-MSPUBParser97::MSPUBParser97(librevenge::RVNGInputStream *input, MSPUBCollector *collector)
-  : MSPUBParser2k(input, collector)
+MSPUBParser97::MSPUBParser97(SubStreamCache &subStreams, MSPUBCollector *collector)
+  : MSPUBParser2k(subStreams, collector)
   , m_bulletLists()
 {
   m_collector->useEncodingHeuristic();
@@ -33,13 +36,13 @@ MSPUBParser97::MSPUBParser97(librevenge::RVNGInputStream *input, MSPUBCollector
 
 bool MSPUBParser97::parse()
 {
-  std::unique_ptr<librevenge::RVNGInputStream> contents(m_input->getSubStreamByName("Contents"));
+  librevenge::RVNGInputStream *contents = m_subStreams.getSubStream("Contents");
   if (!contents)
   {
     MSPUB_DEBUG_MSG(("MSPUBParser97::parse: Couldn't get contents stream.\n"));
     return false;
   }
-  if (!parseContents(contents.get()))
+  if (!parseContents(contents))
   {
     MSPUB_DEBUG_MSG(("MSPUBParser97::parse: Couldn't parse contents stream.\n"));
     return false;
@@ -240,15 +243,17 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
     parseCellStyles(input, id, cellStyles, posToCellMap);
 
   input->seek(textStart, librevenge::RVNG_SEEK_SET);
+  unsigned length = std::min(textEnd - textStart, m_length); // sanity check
+  // load the text zone once, with one more byte: a v2 field code can follow its last character
+  ByteReader text(input, length + 1);
   std::map<unsigned,MSPUBParser97::What> posToTypeMap;
-  getTextInfo(input, textEnd - textStart, posToTypeMap);
+  getTextInfo(text, length, posToTypeMap);
 
-  input->seek(textStart, librevenge::RVNG_SEEK_SET);
-  unsigned length = std::min(textEnd - textStart, m_length); // sanity check
   unsigned shape=0;
   std::vector<TextParagraph> shapeParas;
   std::vector<TextSpan> paraSpans;
   std::vector<unsigned char> spanChars;
+  TextArena &textArena = m_collector->getTextArena();
   std::vector<unsigned> cellEnds;
   CharacterStyle charStyle;
   ParagraphStyle paraStyle;
@@ -261,14 +266,14 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
   for (unsigned c=0; c<length; ++c)
   {
     // change of style
-    auto actPos=input->tell();
+    auto actPos=text.tell();
     auto cIt=posToSpanMap.find(unsigned(actPos));
     if (cIt!=posToSpanMap.end())
     {
       if (!spanChars.empty())
       {
         actChar+=spanChars.size();
-        paraSpans.push_back(TextSpan(spanChars,charStyle));
+        paraSpans.push_back(textArena.append(spanChars,charStyle));
         spanChars.clear();
       }
       if (cIt->second<spanStyles.size())
@@ -290,7 +295,7 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
       else
         cellStyleList.push_back(CellStyle());
     }
-    unsigned char ch=readU8(input);
+    unsigned char ch=text.readU8();
 
     // special character
     bool isEndShape=textEndToChunkId.find(c)!=textEndToChunkId.end();
@@ -301,20 +306,20 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
       if (!spanChars.empty())
       {
         actChar+=spanChars.size();
-        paraSpans.push_back(TextSpan(spanChars,charStyle));
+        paraSpans.push_back(textArena.append(spanChars,charStyle));
         spanChars.clear();
       }
       if (special==FieldBegin)   // # 05
       {
         if (m_version==2)
         {
-          input->seek(1, librevenge::RVNG_SEEK_CUR);
+          text.skip(1);
           ++c;
-          ch=readU8(input);
+          ch=text.readU8();
         }
         if (ch==0x5)
         {
-          TextSpan pageSpan(spanChars,charStyle);
+          TextSpan pageSpan = textArena.append(spanChars,charStyle);
           pageSpan.field=Field(Field::PageNumber);
           paraSpans.push_back(pageSpan);
         }
@@ -329,7 +334,7 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
           };
           if (*charStyle.fieldId>=1 && *charStyle.fieldId<=MSPUB_N_ELEMENTS(dtFormat))
           {
-            TextSpan dtSpan(spanChars,charStyle);
+            TextSpan dtSpan = textArena.append(spanChars,charStyle);
             dtSpan.field=Field(*charStyle.fieldId<12 ? Field::Date : Field::Time);
             dtSpan.field->m_DTFormat=dtFormat[*charStyle.fieldId-1];
             paraSpans.push_back(dtSpan);
@@ -406,7 +411,7 @@ void MSPUBParser97::parseContentsTextIfNecessary(librevenge::RVNGInputStream *in
   if (!spanChars.empty())
   {
     actChar+=spanChars.size();
-    paraSpans.push_back(TextSpan(spanChars,charStyle));
+    paraSpans.push_back(textArena.append(spanChars,charStyle));
   }
   if (!paraSpans.empty())
     shapeParas.push_back(TextParagraph(paraSpans, paraStyle));
@@ -919,15 +924,15 @@ CharacterStyle MSPUBParser97::readCharacterStyle(
   return style;
 }
 
-void MSPUBParser97::getTextInfo(librevenge::RVNGInputStream *input, unsigned length, std::map<unsigned,MSPUBParser97::What> &posToType)
+void MSPUBParser97::getTextInfo(ByteReader text, unsigned length, std::map<unsigned,MSPUBParser97::What> &posToType)
 {
   length = std::min(length, m_length); // sanity check
-  unsigned start = unsigned(input->tell());
+  const unsigned long end = text.tell() + length;
   unsigned char last = '\0';
   unsigned pos=0;
-  while (stillReading(input, start + length))
+  while (text.stillReading(end))
   {
-    unsigned char ch=readU8(input);
+    unsigned char ch=text.readU8();
     if (last == 0xD && ch == 0xA)
       posToType[pos]=LineEnd;
     else if (ch == 0xC)
@@ -18,6 +18,7 @@
 
 namespace libmspub
 {
+class ByteReader;
 struct ListInfo;
 struct CellStyle;
 class MSPUBParser97 : public MSPUBParser2k
@@ -41,9 +42,9 @@ class MSPUBParser97 : public MSPUBParser2k
                           unsigned textId, unsigned numCols, unsigned numRows, unsigned width, unsigned height) override;
   void parseClipPath(librevenge::RVNGInputStream *input, unsigned seqNum, ChunkHeader2k const &header) override;
   void parseContentsTextIfNecessary(librevenge::RVNGInputStream *input) override;
-  void getTextInfo(librevenge::RVNGInputStream *input, unsigned length, std::map<unsigned,MSPUBParser97::What> &posToType);
+  void getTextInfo(ByteReader text, unsigned length, std::map<unsigned,MSPUBParser97::What> &posToType);
 public:
-  MSPUBParser97(librevenge::RVNGInputStream *input, MSPUBCollector *collector);
+  MSPUBParser97(SubStreamCache &subStreams, MSPUBCollector *collector);
   bool parse() override;
 
 protected:
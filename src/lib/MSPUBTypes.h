@@ -10,6 +10,7 @@
 #ifndef INCLUDED_MSPUBTYPES_H
 #define INCLUDED_MSPUBTYPES_H
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -252,8 +253,24 @@ struct Field
 
 struct TextSpan
 {
-  TextSpan(const std::vector<unsigned char> &c, const CharacterStyle &s) : chars(c), style(s), field() { }
-  std::vector<unsigned char> chars;
+  //! Creates a span on length bytes of a text buffer shared with other spans, see TextArena
+  TextSpan(const std::shared_ptr<const std::vector<unsigned char> > &b, std::size_t o, std::size_t l, const CharacterStyle &s)
+    : buffer(b), offset(o), length(l), style(s), field() { }
+  const unsigned char *data() const
+  {
+    return length ? buffer->data() + offset : nullptr;
+  }
+  std::size_t size() const
+  {
+    return length;
+  }
+  bool empty() const
+  {
+    return length == 0;
+  }
+  std::shared_ptr<const std::vector<unsigned char> > buffer;
+  std::size_t offset;
+  std::size_t length;
   CharacterStyle style;
   boost::optional<Field> field;
 };
@@ -11,10 +11,13 @@
 
 #include <algorithm>
 #include <math.h>
+#include <memory>
+#include <mutex>
 
 #include <librevenge/librevenge.h>
 
 #include "ColorReference.h"
+#include "GuideEvaluator.h"
 #include "Line.h"
 #include "MSPUBCollector.h"
 #include "ShapeType.h"
@@ -5462,7 +5465,7 @@ const CustomShape CS_BLOCK_ARC_2(
   nullptr, 0);
 
 
-const CustomShape *getCustomShape(ShapeType type)
+static const CustomShape *getStaticCustomShape(ShapeType type)
 {
   switch (type)
   {
@@ -5826,31 +5829,6 @@ const CustomShape *getCustomShape(ShapeType type)
   }
 }
 
-enum Command
-{
-  MOVETO,
-  LINETO,
-  CURVETO,
-  NOFILL,
-  NOSTROKE,
-  ANGLEELLIPSE,
-  CLOSESUBPATH,
-  ARCTO,
-  ARC,
-  CLOCKWISEARCTO,
-  CLOCKWISEARC,
-  ENDSUBPATH,
-  ELLIPTICALQUADRANTX,
-  ELLIPTICALQUADRANTY
-};
-
-struct ShapeElementCommand
-{
-  Command m_command;
-  unsigned char m_count;
-  ShapeElementCommand(Command command, unsigned char count) : m_command(command), m_count(count) { }
-};
-
 static ShapeElementCommand getCommandFromBinary(unsigned short binary)
 {
   Command cmd;
@@ -5924,12 +5902,68 @@ static ShapeElementCommand getCommandFromBinary(unsigned short binary)
   return ShapeElementCommand(cmd, static_cast<unsigned char>(count));
 }
 
-static double getSpecialIfNecessary(std::function<double(unsigned index)> calculator, int val)
+static std::vector<ShapeElementCommand> decodeCommands(const CustomShape &shape)
+{
+  std::vector<ShapeElementCommand> commands;
+  if (!shape.mp_elements)
+    return commands;
+  commands.reserve(shape.m_numElements);
+  for (unsigned i = 0; i < shape.m_numElements; ++i)
+    commands.push_back(getCommandFromBinary(shape.mp_elements[i]));
+  return commands;
+}
+
+// the compiled shapes are indexed by ShapeType, up to the last one of Publisher 2
+static const unsigned NUM_COMPILED_SHAPE_TYPES = BLOCK_ARC_2 + 1;
+
+static void compileCustomShape(const CustomShape *shape, CompiledCustomShape &compiled)
+{
+  compiled.m_commands = decodeCommands(*shape);
+  compiled.m_guideOrder = GuideEvaluator::getEvaluationOrder(shape);
+  compiled.m_usesAspectRatio = GuideEvaluator::usesAspectRatio(shape);
+  compiled.m_shape = shape;
+}
+
+const CompiledCustomShape *getCompiledCustomShape(ShapeType type)
+{
+  if (type < 0 || unsigned(type) >= NUM_COMPILED_SHAPE_TYPES)
+    return nullptr;
+  const CustomShape *const shape = getStaticCustomShape(type);
+  if (!shape)
+    return nullptr;
+  // each shape is compiled the first time it is used
+  static CompiledCustomShape table[NUM_COMPILED_SHAPE_TYPES];
+  static std::mutex tableMutex;
+  std::lock_guard<std::mutex> lock(tableMutex);
+  CompiledCustomShape &compiled = table[type];
+  if (!compiled.m_shape)
+    compileCustomShape(shape, compiled);
+  return &compiled;
+}
+
+const CustomShape *getCustomShape(ShapeType type)
+{
+  return getStaticCustomShape(type);
+}
+
+static double getSpecialIfNecessary(const std::function<double(unsigned index)> &calculator, int val)
 {
   bool special = unsigned(val) & 0x80000000;
   return special ? calculator(unsigned(val) ^ 0x80000000) : val;
 }
 
+std::vector<Vector2D> resolveVertices(const CustomShape &shape, const std::function<double(unsigned index)> &calculator)
+{
+  std::vector<Vector2D> vertices;
+  if (!shape.mp_vertices)
+    return vertices;
+  vertices.reserve(shape.m_numVertices);
+  for (unsigned i = 0; i < shape.m_numVertices; ++i)
+    vertices.push_back(Vector2D(getSpecialIfNecessary(calculator, shape.mp_vertices[i].m_x),
+                                getSpecialIfNecessary(calculator, shape.mp_vertices[i].m_y)));
+  return vertices;
+}
+
 namespace
 {
 
@@ -5958,25 +5992,37 @@ private:
 
 }
 
+//! Returns the vertices scaled and moved into the shape's box, not yet transformed
+static std::vector<Vector2D> placeVertices(const std::vector<Vector2D> &resolvedVertices, double x, double y, double scaleX, double scaleY)
+{
+  std::vector<Vector2D> placed;
+  placed.reserve(resolvedVertices.size());
+  for (const auto &vertex : resolvedVertices)
+    placed.push_back(Vector2D(x + scaleX * vertex.m_x, y + scaleY * vertex.m_y));
+  return placed;
+}
+
 static void drawEmulatedLine(std::shared_ptr<const CustomShape> shape, ShapeType shapeType, const std::vector<Line> &lines,
                              Vector2D center, VectorTransformation2D transform,
                              double x, double y, double scaleX, double scaleY,
                              bool drawStroke, librevenge::RVNGPropertyList &graphicsProps, librevenge::RVNGDrawingInterface *painter,
-                             std::function<double(unsigned index)> calculator,
+                             const std::vector<Vector2D> &resolvedVertices,
                              const std::vector<Color> &palette)
 {
   std::vector<LineInfo> lineInfos;
   unsigned i_line = 0;
   bool rectangle = isShapeTypeRectangle(shapeType) && !lines.empty(); // ugly HACK: special handling for rectangle outlines.
+  // the ends of all the segments, first collected, then transformed at once
+  std::vector<Vector2D> points;
+  std::vector<unsigned> lineIndices;
+  points.reserve(2 * shape->m_numVertices);
+  lineIndices.reserve(shape->m_numVertices);
   Vector2D vector(0, 0);
   Vector2D old(0, 0);
   for (unsigned i = 0; i < shape->m_numVertices; ++i)
   {
-    librevenge::RVNGPropertyListVector vertices;
-    librevenge::RVNGPropertyList vertex;
     if (i > 0)
     {
-      librevenge::RVNGPropertyList vertexStart;
       double lineWidth = double(lines[i_line].m_widthInEmu) / EMUS_IN_INCH;
       switch (i - 1) // fudge the lines inward by half their width so they are fully inside the shape and hence proper borders
       {
@@ -5995,13 +6041,10 @@ static void drawEmulatedLine(std::shared_ptr<const CustomShape> shape, ShapeType
       default:
         break;
       }
-      old = transform.transformWithOrigin(old, center);
-      vertexStart.insert("svg:x", old.m_x);
-      vertexStart.insert("svg:y", old.m_y);
-      vertices.append(vertexStart);
+      points.push_back(old);
     }
-    vector.m_x = x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[i].m_x);
-    vector.m_y = y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[i].m_y);
+    vector.m_x = x + scaleX * resolvedVertices[i].m_x;
+    vector.m_y = y + scaleY * resolvedVertices[i].m_y;
     old = vector;
     if (rectangle)
     {
@@ -6024,13 +6067,10 @@ static void drawEmulatedLine(std::shared_ptr<const CustomShape> shape, ShapeType
         break;
       }
     }
-    vector = transform.transformWithOrigin(vector, center);
-    vertex.insert("svg:x", vector.m_x);
-    vertex.insert("svg:y", vector.m_y);
-    vertices.append(vertex);
     if (i > 0)
     {
-      lineInfos.push_back(LineInfo(vertices, lines[i_line], palette));
+      points.push_back(vector);
+      lineIndices.push_back(i_line);
       if (drawStroke)
       {
         if (i_line + 1 < lines.size()) // continue using the last element if we run out of lines.
@@ -6040,6 +6080,20 @@ static void drawEmulatedLine(std::shared_ptr<const CustomShape> shape, ShapeType
       }
     }
   }
+  transform.transformWithOrigin(points, center);
+  for (size_t i = 0; i < lineIndices.size(); ++i)
+  {
+    librevenge::RVNGPropertyListVector vertices;
+    librevenge::RVNGPropertyList vertexStart;
+    vertexStart.insert("svg:x", points[2 * i].m_x);
+    vertexStart.insert("svg:y", points[2 * i].m_y);
+    vertices.append(vertexStart);
+    librevenge::RVNGPropertyList vertex;
+    vertex.insert("svg:x", points[2 * i + 1].m_x);
+    vertex.insert("svg:y", points[2 * i + 1].m_y);
+    vertices.append(vertex);
+    lineInfos.push_back(LineInfo(vertices, lines[lineIndices[i]], palette));
+  }
 
   if (lineInfos.empty())
     return;
@@ -6128,25 +6182,23 @@ librevenge::RVNGPropertyList calcClipPath(const std::vector<Vertex> &verts, doub
   double scaleX = width / shape->m_coordWidth;
   double scaleY = height / shape->m_coordHeight;
   librevenge::RVNGString clipString;
-  Vector2D vector(x + scaleX * verts[0].m_x, y + scaleY * verts[0].m_y);
-  vector = transform.transformWithOrigin(vector, center);
-  librevenge::RVNGString sValue;
-  sValue.sprintf("M %f %f", double(vector.m_x), double(vector.m_y));
-  clipString.append(sValue);
-  for (size_t i = 1; i < verts.size(); ++i)
+  std::vector<Vector2D> points;
+  points.reserve(verts.size());
+  for (const auto &vert : verts)
+    points.push_back(Vector2D(x + scaleX * vert.m_x, y + scaleY * vert.m_y));
+  transform.transformWithOrigin(points, center);
+  for (size_t i = 0; i < points.size(); ++i)
   {
-    Vector2D vector2(x + scaleX * verts[i].m_x, y + scaleY * verts[i].m_y);
-    vector2 = transform.transformWithOrigin(vector2, center);
-    librevenge::RVNGString sValue2;
-    sValue2.sprintf(" L %f %f", double(vector2.m_x), double(vector2.m_y));
-    clipString.append(sValue2);
+    librevenge::RVNGString sValue;
+    sValue.sprintf(i == 0 ? "M %f %f" : " L %f %f", double(points[i].m_x), double(points[i].m_y));
+    clipString.append(sValue);
   }
   clipString.append(" Z");
   vertices.insert("svg:clip-path", clipString);
   return vertices;
 }
 
-void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphicsProps, librevenge::RVNGDrawingInterface *painter, double x, double y, double height, double width, bool closeEverything, VectorTransformation2D transform, std::vector<Line> lines, std::function<double(unsigned index)> calculator, const std::vector<Color> &palette, std::shared_ptr<const CustomShape> shape)
+void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphicsProps, librevenge::RVNGDrawingInterface *painter, double x, double y, double height, double width, bool closeEverything, VectorTransformation2D transform, std::vector<Line> lines, const std::vector<Vector2D> &resolvedVertices, const std::vector<Color> &palette, std::shared_ptr<const CustomShape> shape)
 {
   //MSPUB_DEBUG_MSG(("***STARTING CUSTOM SHAPE***\n"));
   if (!shape)
@@ -6179,7 +6231,7 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
       if (!allLinesSame)
       {
         drawEmulatedLine(shape, shapeType, lines, center, transform,
-                         x, y, scaleX, scaleY, drawStroke, graphicsProps, painter, calculator, palette);
+                         x, y, scaleX, scaleY, drawStroke, graphicsProps, painter, resolvedVertices, palette);
         shouldDrawShape = false;
       }
       else if (drawStroke)
@@ -6197,14 +6249,13 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
     if (shouldDrawShape)
     {
       librevenge::RVNGPropertyListVector vertices;
-      for (unsigned i = 0; i < shape->m_numVertices; ++i)
+      std::vector<Vector2D> placed = placeVertices(resolvedVertices, x, y, scaleX, scaleY);
+      transform.transformWithOrigin(placed, center);
+      for (const auto &point : placed)
       {
         librevenge::RVNGPropertyList vertex;
-        Vector2D vector(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[i].m_x),
-                        y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[i].m_y));
-        vector = transform.transformWithOrigin(vector, center);
-        vertex.insert("svg:x", vector.m_x);
-        vertex.insert("svg:y", vector.m_y);
+        vertex.insert("svg:x", point.m_x);
+        vertex.insert("svg:y", point.m_y);
         vertices.append(vertex);
       }
       librevenge::RVNGPropertyList points;
@@ -6234,9 +6285,18 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
     // so we have to keep track of the following, rather than just adding a 'Z'
     // directive on path close and expecting everything to work.
     boost::optional<Vector2D> pathBegin;
-    for (unsigned i = 0; i < shape->m_numElements; ++i)
+    // the vertices in the shape's box, and the same ones transformed in one pass
+    const std::vector<Vector2D> placed = placeVertices(resolvedVertices, x, y, scaleX, scaleY);
+    std::vector<Vector2D> transformed(placed);
+    transform.transformWithOrigin(transformed, center);
+    // the built-in shapes come with their commands already decoded
+    const CompiledCustomShape *const compiled = getCompiledCustomShape(shapeType);
+    const bool isBuiltIn = compiled && compiled->m_shape == shape.get();
+    const std::vector<ShapeElementCommand> decodedCommands = isBuiltIn ? std::vector<ShapeElementCommand>() : decodeCommands(*shape);
+    const std::vector<ShapeElementCommand> &commands = isBuiltIn ? compiled->m_commands : decodedCommands;
+    for (auto it = commands.begin(); it != commands.end(); ++it)
     {
-      ShapeElementCommand cmd = getCommandFromBinary(shape->mp_elements[i]);
+      const ShapeElementCommand &cmd = *it;
       switch (cmd.m_command)
       {
       case ELLIPTICALQUADRANTX:
@@ -6256,8 +6316,7 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         for (unsigned j = 0; (j < cmd.m_count) && (vertexIndex < shape->m_numVertices); ++j, ++vertexIndex)
         {
           bool modifier = cmd.m_command == ELLIPTICALQUADRANTX ? true : false;
-          const Vertex &curr = shape->mp_vertices[vertexIndex];
-          Vector2D curr2D(x + scaleX * getSpecialIfNecessary(calculator, curr.m_x), y + scaleY * getSpecialIfNecessary(calculator, curr.m_y));
+          const Vector2D &curr2D = placed[vertexIndex];
           if (bool(lastPoint))
           {
             if (!pathBegin)
@@ -6309,15 +6368,15 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
             Vector2D vec2(curr2D.m_x + vecX, curr2D.m_y + vecY);
             vec1 = transform.transformWithOrigin(vec1, center);
             vec2 = transform.transformWithOrigin(vec2, center);
-            curr2D = transform.transformWithOrigin(curr2D, center);
+            const Vector2D &currTransformed = transformed[vertexIndex];
             librevenge::RVNGPropertyList bezier;
             bezier.insert("librevenge:path-action", "C");
             bezier.insert("svg:x1", vec1.m_x);
             bezier.insert("svg:x2", vec2.m_x);
             bezier.insert("svg:y1", vec1.m_y);
             bezier.insert("svg:y2", vec2.m_y);
-            bezier.insert("svg:x", curr2D.m_x);
-            bezier.insert("svg:y", curr2D.m_y);
+            bezier.insert("svg:x", currTransformed.m_x);
+            bezier.insert("svg:y", currTransformed.m_y);
             vertices.append(bezier);
           }
           else
@@ -6333,8 +6392,7 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
                 vertices.append(closeVertex);
               }
               hasUnclosedElements = false;
-              Vector2D new_(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x), y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y));
-              new_ = transform.transformWithOrigin(new_, center);
+              const Vector2D &new_ = transformed[vertexIndex];
               moveVertex.insert("svg:x", new_.m_x);
               moveVertex.insert("svg:y", new_.m_y);
               moveVertex.insert("librevenge:path-action", "M");
@@ -6380,27 +6438,27 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         {
           for (unsigned k = 0; k < 4; ++k)
           {
-            MSPUB_DEBUG_MSG(("Calculated vertex x: %f, y: %f\n", getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + k].m_x), getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + k].m_y)));
+            MSPUB_DEBUG_MSG(("Calculated vertex x: %f, y: %f\n", resolvedVertices[vertexIndex + k].m_x, resolvedVertices[vertexIndex + k].m_y));
           }
           bool to = cmd.m_command == CLOCKWISEARCTO || cmd.m_command == ARCTO;
           bool clockwise = cmd.m_command == CLOCKWISEARCTO || cmd.m_command == CLOCKWISEARC;
-          const Vertex &bound1 = shape->mp_vertices[vertexIndex];
-          const Vertex &bound2 = shape->mp_vertices[vertexIndex + 1];
-          const Vertex &start  = shape->mp_vertices[vertexIndex + 2];
-          const Vertex &end    = shape->mp_vertices[vertexIndex + 3];
-
-          double bound1X = x + scaleX * getSpecialIfNecessary(calculator, bound1.m_x);
-          double bound1Y = y + scaleY * getSpecialIfNecessary(calculator, bound1.m_y);
-          double bound2X = x + scaleX * getSpecialIfNecessary(calculator, bound2.m_x);
-          double bound2Y = y + scaleY * getSpecialIfNecessary(calculator, bound2.m_y);
+          const Vector2D &bound1 = resolvedVertices[vertexIndex];
+          const Vector2D &bound2 = resolvedVertices[vertexIndex + 1];
+          const Vector2D &start  = resolvedVertices[vertexIndex + 2];
+          const Vector2D &end    = resolvedVertices[vertexIndex + 3];
+
+          double bound1X = x + scaleX * bound1.m_x;
+          double bound1Y = y + scaleY * bound1.m_y;
+          double bound2X = x + scaleX * bound2.m_x;
+          double bound2Y = y + scaleY * bound2.m_y;
           double rx = fabs(bound1X - bound2X) / 2;
           double ry = fabs(bound1Y - bound2Y) / 2;
           double cx = (bound1X + bound2X) / 2;
           double cy = (bound1Y + bound2Y) / 2;
-          double startX = x + scaleX * getSpecialIfNecessary(calculator, start.m_x);
-          double startY = y + scaleY * getSpecialIfNecessary(calculator, start.m_y);
-          double endX = x + scaleX * getSpecialIfNecessary(calculator, end.m_x);
-          double endY = y + scaleY * getSpecialIfNecessary(calculator, end.m_y);
+          double startX = x + scaleX * start.m_x;
+          double startY = y + scaleY * start.m_y;
+          double endX = x + scaleX * end.m_x;
+          double endY = y + scaleY * end.m_y;
           getRayEllipseIntersection(startX, startY, rx, ry, cx, cy, startX, startY);
           getRayEllipseIntersection(endX, endY, rx, ry, cx, cy, endX, endY);
           Vector2D start2D(startX, startY);
@@ -6449,12 +6507,12 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         {
           hasUnclosedElements = true;
           librevenge::RVNGPropertyList vertex;
-          double startAngle = getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 2].m_x);
-          double endAngle = getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 2].m_y);
-          double cx = x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x);
-          double cy = y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y);
-          double rx = scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 1].m_x);
-          double ry = scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 1].m_y);
+          double startAngle = resolvedVertices[vertexIndex + 2].m_x;
+          double endAngle = resolvedVertices[vertexIndex + 2].m_y;
+          double cx = x + scaleX * resolvedVertices[vertexIndex].m_x;
+          double cy = y + scaleY * resolvedVertices[vertexIndex].m_y;
+          double rx = scaleX * resolvedVertices[vertexIndex + 1].m_x;
+          double ry = scaleY * resolvedVertices[vertexIndex + 1].m_y;
 
           // FIXME: Are angles supposed to be the actual angle of the point with the x-axis,
           // or the eccentric anomaly, or something else?
@@ -6500,7 +6558,7 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         MSPUB_DEBUG_MSG(("MOVETO %d\n", cmd.m_count));
         for (unsigned j = 0; (j < cmd.m_count) && (vertexIndex < shape->m_numVertices); ++j, ++vertexIndex)
         {
-          MSPUB_DEBUG_MSG(("x: %f, y: %f\n", getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x), getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y)));
+          MSPUB_DEBUG_MSG(("x: %f, y: %f\n", resolvedVertices[vertexIndex].m_x, resolvedVertices[vertexIndex].m_y));
           if (hasUnclosedElements && closeEverything)
           {
             librevenge::RVNGPropertyList closeVertex;
@@ -6509,11 +6567,9 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
           }
           hasUnclosedElements = false;
           librevenge::RVNGPropertyList moveVertex;
-          Vector2D new_(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x),
-                        y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y));
-          pathBegin = new_;
-          lastPoint = new_;
-          new_ = transform.transformWithOrigin(new_, center);
+          pathBegin = placed[vertexIndex];
+          lastPoint = placed[vertexIndex];
+          const Vector2D &new_ = transformed[vertexIndex];
           moveVertex.insert("svg:x", new_.m_x);
           moveVertex.insert("svg:y", new_.m_y);
           moveVertex.insert("librevenge:path-action", "M");
@@ -6524,13 +6580,11 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         MSPUB_DEBUG_MSG(("LINETO %d\n", cmd.m_count));
         for (unsigned j = 0; (j < cmd.m_count) && (vertexIndex < shape->m_numVertices); ++j, ++vertexIndex)
         {
-          MSPUB_DEBUG_MSG(("x: %f, y: %f\n", getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x), getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y)));
+          MSPUB_DEBUG_MSG(("x: %f, y: %f\n", resolvedVertices[vertexIndex].m_x, resolvedVertices[vertexIndex].m_y));
           hasUnclosedElements = true;
           librevenge::RVNGPropertyList vertex;
-          Vector2D vector(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x),
-                          y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y));
-          lastPoint = vector;
-          vector = transform.transformWithOrigin(vector, center);
+          lastPoint = placed[vertexIndex];
+          const Vector2D &vector = transformed[vertexIndex];
           vertex.insert("svg:x", vector.m_x);
           vertex.insert("svg:y", vector.m_y);
           vertex.insert("librevenge:path-action", "L");
@@ -6542,16 +6596,10 @@ void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphic
         for (unsigned j = 0; (j < cmd.m_count) && (vertexIndex + 2 < shape->m_numVertices); ++j, vertexIndex += 3)
         {
           hasUnclosedElements = true;
-          Vector2D firstCtrl(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_x),
-                             y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex].m_y));
-          firstCtrl = transform.transformWithOrigin(firstCtrl, center);
-          Vector2D secondCtrl(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 1].m_x),
-                              y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 1].m_y));
-          secondCtrl = transform.transformWithOrigin(secondCtrl, center);
-          Vector2D end(x + scaleX * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 2].m_x),
-                       y + scaleY * getSpecialIfNecessary(calculator, shape->mp_vertices[vertexIndex + 2].m_y));
-          lastPoint = end;
-          end = transform.transformWithOrigin(end, center);
+          const Vector2D &firstCtrl = transformed[vertexIndex];
+          const Vector2D &secondCtrl = transformed[vertexIndex + 1];
+          lastPoint = placed[vertexIndex + 2];
+          const Vector2D &end = transformed[vertexIndex + 2];
           librevenge::RVNGPropertyList bezier;
           bezier.insert("librevenge:path-action", "C");
           bezier.insert("svg:x1", firstCtrl.m_x);
@@ -6630,25 +6678,43 @@ bool isShapeTypeRectangle(ShapeType type)
 }
 
 
-std::shared_ptr<const CustomShape> getFromDynamicCustomShape(const DynamicCustomShape &dcs)
-{
-  return std::shared_ptr<const CustomShape>(new CustomShape(
-                                              dcs.m_vertices.empty() ? nullptr : dcs.m_vertices.data(),
-                                              unsigned(dcs.m_vertices.size()),
-                                              dcs.m_elements.empty() ? nullptr : dcs.m_elements.data(),
-                                              unsigned(dcs.m_elements.size()),
-                                              dcs.m_calculations.empty() ? nullptr : dcs.m_calculations.data(),
-                                              unsigned(dcs.m_calculations.size()),
-                                              dcs.m_defaultAdjustValues.empty() ? nullptr :
-                                              dcs.m_defaultAdjustValues.data(),
-                                              unsigned(dcs.m_defaultAdjustValues.size()),
-                                              dcs.m_textRectangles.empty() ? nullptr : dcs.m_textRectangles.data(),
-                                              unsigned(dcs.m_textRectangles.size()),
-                                              dcs.m_coordWidth, dcs.m_coordHeight,
-                                              dcs.m_gluePoints.empty() ? nullptr : dcs.m_gluePoints.data(),
-                                              unsigned(dcs.m_gluePoints.size()),
-                                              dcs.m_adjustShiftMask
-                                            ));
+namespace
+{
+
+struct DynamicCustomShapeView
+{
+  explicit DynamicCustomShapeView(const std::shared_ptr<const DynamicCustomShape> &dcs)
+    : m_source(dcs)
+    , m_shape(dcs->m_vertices.empty() ? nullptr : dcs->m_vertices.data(),
+              unsigned(dcs->m_vertices.size()),
+              dcs->m_elements.empty() ? nullptr : dcs->m_elements.data(),
+              unsigned(dcs->m_elements.size()),
+              dcs->m_calculations.empty() ? nullptr : dcs->m_calculations.data(),
+              unsigned(dcs->m_calculations.size()),
+              dcs->m_defaultAdjustValues.empty() ? nullptr :
+              dcs->m_defaultAdjustValues.data(),
+              unsigned(dcs->m_defaultAdjustValues.size()),
+              dcs->m_textRectangles.empty() ? nullptr : dcs->m_textRectangles.data(),
+              unsigned(dcs->m_textRectangles.size()),
+              dcs->m_coordWidth, dcs->m_coordHeight,
+              dcs->m_gluePoints.empty() ? nullptr : dcs->m_gluePoints.data(),
+              unsigned(dcs->m_gluePoints.size()),
+              dcs->m_adjustShiftMask)
+  {
+  }
+
+  std::shared_ptr<const DynamicCustomShape> m_source;
+  CustomShape m_shape;
+};
+
+} // anonymous namespace
+
+std::shared_ptr<const CustomShape> getFromDynamicCustomShape(const std::shared_ptr<const DynamicCustomShape> &dcs)
+{
+  if (!dcs)
+    return std::shared_ptr<const CustomShape>();
+  const std::shared_ptr<const DynamicCustomShapeView> view = std::make_shared<const DynamicCustomShapeView>(dcs);
+  return std::shared_ptr<const CustomShape>(view, &view->m_shape);
 }
 
 }
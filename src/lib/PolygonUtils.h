@@ -32,6 +32,7 @@ const int OTHER_CALC_VAL        = 0x400;
 const int ASPECT_RATIO          = 0x600;
 
 class VectorTransformation2D;
+struct Vector2D;
 
 struct Color;
 struct Line;
@@ -109,12 +110,60 @@ struct DynamicCustomShape
   }
 };
 
-std::shared_ptr<const CustomShape> getFromDynamicCustomShape(const DynamicCustomShape &dcs);
+enum Command
+{
+  MOVETO,
+  LINETO,
+  CURVETO,
+  NOFILL,
+  NOSTROKE,
+  ANGLEELLIPSE,
+  CLOSESUBPATH,
+  ARCTO,
+  ARC,
+  CLOCKWISEARCTO,
+  CLOCKWISEARC,
+  ENDSUBPATH,
+  ELLIPTICALQUADRANTX,
+  ELLIPTICALQUADRANTY
+};
+
+struct ShapeElementCommand
+{
+  Command m_command;
+  unsigned char m_count;
+  ShapeElementCommand(Command command, unsigned char count) : m_command(command), m_count(count) { }
+};
+
+/** A built-in shape, prepared once for painting: its commands decoded and
+    the evaluation order of its guides computed.
+  */
+struct CompiledCustomShape
+{
+  const CustomShape *m_shape;
+  std::vector<ShapeElementCommand> m_commands;
+  std::vector<unsigned> m_guideOrder;
+  bool m_usesAspectRatio;
+
+  CompiledCustomShape()
+    : m_shape(nullptr), m_commands(), m_guideOrder(), m_usesAspectRatio(false)
+  {
+  }
+  CompiledCustomShape(const CompiledCustomShape &) = default;
+  CompiledCustomShape &operator=(const CompiledCustomShape &) = default;
+};
+
+//! Returns a view of dcs as a CustomShape; the view keeps dcs alive
+std::shared_ptr<const CustomShape> getFromDynamicCustomShape(const std::shared_ptr<const DynamicCustomShape> &dcs);
 
+//! Returns the compiled form of the built-in shape of type, or nullptr; each shape is compiled on its first use
+const CompiledCustomShape *getCompiledCustomShape(ShapeType type);
 const CustomShape *getCustomShape(ShapeType type);
 bool isShapeTypeRectangle(ShapeType type);
 librevenge::RVNGPropertyList calcClipPath(const std::vector<libmspub::Vertex> &verts, double x, double y, double height, double width, VectorTransformation2D transform, std::shared_ptr<const CustomShape> shape);
-void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphicsProps, librevenge::RVNGDrawingInterface *painter, double x, double y, double height, double width, bool closeEverything, VectorTransformation2D transform, std::vector<Line> lines, std::function<double(unsigned index)> calculator, const std::vector<Color> &palette, std::shared_ptr<const CustomShape> shape);
+void writeCustomShape(ShapeType shapeType, librevenge::RVNGPropertyList &graphicsProps, librevenge::RVNGDrawingInterface *painter, double x, double y, double height, double width, bool closeEverything, VectorTransformation2D transform, std::vector<Line> lines, const std::vector<Vector2D> &resolvedVertices, const std::vector<Color> &palette, std::shared_ptr<const CustomShape> shape);
+//! Returns the vertices of shape in shape coordinates, with their references to guides evaluated by calculator
+std::vector<Vector2D> resolveVertices(const CustomShape &shape, const std::function<double(unsigned index)> &calculator);
 
 } // libmspub
 #endif /* INCLUDED_POLYGONUTILS_H */
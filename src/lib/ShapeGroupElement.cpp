@@ -17,7 +17,7 @@
 namespace libmspub
 {
 
-ShapeGroupElement::ShapeGroupElement(const std::shared_ptr<ShapeGroupElement> &parent, unsigned seqNum) : m_shapeInfo(), m_parent(parent), m_children(), m_seqNum(seqNum), m_transform()
+ShapeGroupElement::ShapeGroupElement(const std::shared_ptr<ShapeGroupElement> &parent, unsigned seqNum) : m_shapeInfo(nullptr), m_parent(parent), m_children(), m_seqNum(seqNum), m_transform()
 {
 }
 
@@ -35,7 +35,7 @@ std::shared_ptr<ShapeGroupElement> ShapeGroupElement::create(const std::shared_p
 
 void ShapeGroupElement::setShapeInfo(const ShapeInfo &shapeInfo)
 {
-  m_shapeInfo = shapeInfo;
+  m_shapeInfo = &shapeInfo;
 }
 
 void ShapeGroupElement::setTransform(const VectorTransformation2D &transform)
@@ -43,7 +43,7 @@ void ShapeGroupElement::setTransform(const VectorTransformation2D &transform)
   m_transform = transform;
 }
 
-void ShapeGroupElement::setup(std::function<void(ShapeGroupElement &self)> visitor)
+void ShapeGroupElement::setup(const std::function<void(ShapeGroupElement &self)> &visitor)
 {
   visitor(*this);
   for (auto &i : m_children)
@@ -52,13 +52,14 @@ void ShapeGroupElement::setup(std::function<void(ShapeGroupElement &self)> visit
   }
 }
 
-void ShapeGroupElement::visit(std::function<
+void ShapeGroupElement::visit(const std::function<
                               std::function<void(void)>
                               (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)
-                              > visitor, const Coordinate &relativeTo, const VectorTransformation2D &parentFoldedTransform) const
+                              > &visitor, const Coordinate &relativeTo, const VectorTransformation2D &parentFoldedTransform) const
 {
-  const ShapeInfo info = m_shapeInfo.get_value_or(ShapeInfo());
-  Coordinate coord = info.m_coordinates.get_value_or(Coordinate());
+  static const ShapeInfo emptyInfo;
+  const ShapeInfo &info = m_shapeInfo ? *m_shapeInfo : emptyInfo;
+  const Coordinate coord = info.m_coordinates.get_value_or(Coordinate());
   double centerX = (double(coord.m_xs) + double(coord.m_xe)) / (2 * EMUS_IN_INCH);
   double centerY = (double(coord.m_ys) + double(coord.m_ye)) / (2 * EMUS_IN_INCH);
   double relativeCenterX = (double(relativeTo.m_xs) + double(relativeTo.m_xe)) / (2 * EMUS_IN_INCH);
@@ -75,10 +76,10 @@ void ShapeGroupElement::visit(std::function<
   afterOp();
 }
 
-void ShapeGroupElement::visit(std::function<
+void ShapeGroupElement::visit(const std::function<
                               std::function<void(void)>
                               (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)
-                              > visitor) const
+                              > &visitor) const
 {
   Coordinate origin;
   VectorTransformation2D identity;
@@ -14,8 +14,6 @@
 #include <memory>
 #include <vector>
 
-#include <boost/optional.hpp>
-
 #include "ShapeInfo.h"
 #include "VectorTransformation2D.h"
 
@@ -26,7 +24,8 @@ struct Coordinate;
 
 class ShapeGroupElement
 {
-  boost::optional<ShapeInfo> m_shapeInfo;
+  //! the shape's data, owned by the collector
+  const ShapeInfo *m_shapeInfo;
   std::weak_ptr<ShapeGroupElement> m_parent;
   std::vector<std::shared_ptr<ShapeGroupElement>> m_children;
   unsigned m_seqNum;
@@ -40,14 +39,14 @@ public:
   static std::shared_ptr<ShapeGroupElement> create(const std::shared_ptr<ShapeGroupElement> &parent, unsigned seqNum = 0);
 
   void setShapeInfo(const ShapeInfo &shapeInfo);
-  void setup(std::function<void(ShapeGroupElement &self)> visitor);
-  void visit(std::function<
+  void setup(const std::function<void(ShapeGroupElement &self)> &visitor);
+  void visit(const std::function<
              std::function<void(void)>
-             (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)> visitor,
+             (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)> &visitor,
              const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform) const;
-  void visit(std::function<
+  void visit(const std::function<
              std::function<void(void)>
-             (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)> visitor) const;
+             (const ShapeInfo &info, const Coordinate &relativeTo, const VectorTransformation2D &foldedTransform, bool isGroup, const VectorTransformation2D &thisTransform)> &visitor) const;
   bool isGroup() const;
   std::shared_ptr<ShapeGroupElement> getParent() const;
   void setSeqNum(unsigned seqNum);
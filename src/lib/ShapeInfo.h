@@ -54,7 +54,9 @@ struct ShapeInfo
   boost::optional<Margins> m_margins;
   boost::optional<BorderPosition> m_borderPosition; // Irrelevant except for rectangular shapes
   std::shared_ptr<const Fill> m_fill;
-  boost::optional<DynamicCustomShape> m_customShape;
+  std::shared_ptr<const DynamicCustomShape> m_customShape;
+  //! the shape returned by getCustomShape, once resolveCustomShape is called
+  std::shared_ptr<const CustomShape> m_resolvedCustomShape;
   bool m_stretchBorderArt;
   boost::optional<ColorReference> m_lineBackColor;
   boost::optional<Dash> m_dash;
@@ -74,18 +76,28 @@ struct ShapeInfo
     m_coordinates(), m_lines(), m_pageSeqNum(),
     m_textId(), m_adjustValuesByIndex(), m_adjustValues(),
     m_rotation(), m_flips(), m_margins(), m_borderPosition(),
-    m_fill(), m_customShape(), m_stretchBorderArt(false),
+    m_fill(), m_customShape(), m_resolvedCustomShape(), m_stretchBorderArt(false),
     m_lineBackColor(), m_dash(), m_tableInfo(),
     m_numColumns(),
     m_columnSpacing(0), m_beginArrow(), m_endArrow(),
     m_verticalAlign(), m_pictureRecolor(), m_shadow(), m_innerRotation(), m_clipPath(), m_pictureBrightness(), m_pictureContrast()
   {
   }
+  //! Builds the shape once, when the shape's geometry does not change anymore
+  void resolveCustomShape()
+  {
+    m_resolvedCustomShape.reset();
+    m_resolvedCustomShape = getCustomShape();
+  }
   std::shared_ptr<const CustomShape> getCustomShape() const
   {
+    if (m_resolvedCustomShape)
+    {
+      return m_resolvedCustomShape;
+    }
     if (bool(m_customShape))
     {
-      return getFromDynamicCustomShape(m_customShape.get());
+      return getFromDynamicCustomShape(m_customShape);
     }
     if (bool(m_cropType))
     {
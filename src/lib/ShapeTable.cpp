@@ -0,0 +1,74 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "ShapeTable.h"
+
+namespace libmspub
+{
+
+namespace
+{
+
+//! seqNums below twice the number of shapes plus this margin are indexed directly
+const unsigned DENSE_SEQNUM_MARGIN = 4096;
+
+const unsigned NO_SLOT = unsigned(-1);
+
+} // anonymous namespace
+
+ShapeTable::ShapeTable()
+  : m_shapeInfos()
+  , m_slotsBySeqNum()
+  , m_overflowSlotsBySeqNum()
+{
+}
+
+unsigned ShapeTable::findSlot(unsigned seqNum) const
+{
+  if (seqNum < m_slotsBySeqNum.size())
+    return m_slotsBySeqNum[seqNum];
+  const auto it = m_overflowSlotsBySeqNum.find(seqNum);
+  return it == m_overflowSlotsBySeqNum.end() ? NO_SLOT : it->second;
+}
+
+ShapeInfo &ShapeTable::operator[](unsigned seqNum)
+{
+  const unsigned slot = findSlot(seqNum);
+  if (slot != NO_SLOT)
+    return m_shapeInfos[slot];
+
+  const auto newSlot = unsigned(m_shapeInfos.size());
+  if (seqNum < m_slotsBySeqNum.size())
+    m_slotsBySeqNum[seqNum] = newSlot;
+  else if (seqNum < 2 * (m_shapeInfos.size() + 1) + DENSE_SEQNUM_MARGIN)
+  {
+    m_slotsBySeqNum.resize(seqNum + 1, NO_SLOT);
+    m_slotsBySeqNum[seqNum] = newSlot;
+  }
+  else
+    m_overflowSlotsBySeqNum[seqNum] = newSlot;
+  m_shapeInfos.push_back(ShapeInfo());
+  return m_shapeInfos.back();
+}
+
+ShapeInfo *ShapeTable::find(unsigned seqNum)
+{
+  const unsigned slot = findSlot(seqNum);
+  return slot == NO_SLOT ? nullptr : &m_shapeInfos[slot];
+}
+
+const ShapeInfo *ShapeTable::find(unsigned seqNum) const
+{
+  const unsigned slot = findSlot(seqNum);
+  return slot == NO_SLOT ? nullptr : &m_shapeInfos[slot];
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,62 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_SHAPETABLE_H
+#define INCLUDED_SHAPETABLE_H
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include "ShapeInfo.h"
+
+namespace libmspub
+{
+
+/** The ShapeInfos of a document, by seqNum.
+
+    Shapes live in slots handed out in the order they are first seen. The
+    seqNums of a document are small and close together, so the slot of a
+    seqNum is found by indexing a vector; seqNums far beyond the number of
+    shapes (broken files) go to an overflow map instead of growing it.
+    Slots are kept in a deque: a ShapeInfo never moves once created, so
+    pointers to it stay valid while other shapes are added.
+  */
+class ShapeTable
+{
+public:
+  ShapeTable();
+
+  //! Returns the ShapeInfo of seqNum, creating it if needed.
+  ShapeInfo &operator[](unsigned seqNum);
+  //! Returns the ShapeInfo of seqNum, or nullptr.
+  ShapeInfo *find(unsigned seqNum);
+  const ShapeInfo *find(unsigned seqNum) const;
+
+  bool empty() const
+  {
+    return m_shapeInfos.empty();
+  }
+  std::size_t size() const
+  {
+    return m_shapeInfos.size();
+  }
+
+private:
+  unsigned findSlot(unsigned seqNum) const;
+
+  std::deque<ShapeInfo> m_shapeInfos;
+  std::vector<unsigned> m_slotsBySeqNum;
+  std::unordered_map<unsigned, unsigned> m_overflowSlotsBySeqNum;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_SHAPETABLE_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,47 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "SubStreamCache.h"
+
+#include <utility>
+
+#include "libmspub_utils.h"
+
+namespace libmspub
+{
+
+SubStreamCache::SubStreamCache(librevenge::RVNGInputStream *input)
+  : m_input(input)
+  , m_subStreams()
+{
+}
+
+librevenge::RVNGInputStream *SubStreamCache::getSubStream(const char *name)
+{
+  if (!m_input || !name)
+    return nullptr;
+  auto it = m_subStreams.find(name);
+  if (it == m_subStreams.end())
+  {
+    // also remember the streams which do not exist
+    std::unique_ptr<librevenge::RVNGInputStream> stream;
+    if (m_input->isStructured())
+      stream.reset(m_input->getSubStreamByName(name));
+    MSPUB_DEBUG_MSG(("SubStreamCache::getSubStream: opening %s %s\n", name, stream ? "done" : "failed"));
+    it = m_subStreams.insert(std::make_pair(std::string(name), std::move(stream))).first;
+  }
+  librevenge::RVNGInputStream *stream = it->second.get();
+  if (stream)
+    stream->seek(0, librevenge::RVNG_SEEK_SET);
+  return stream;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,54 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_SUBSTREAMCACHE_H
+#define INCLUDED_SUBSTREAMCACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+namespace libmspub
+{
+
+/** Opens each named sub-stream of a document at most once.
+
+    Extracting a sub-stream from an OLE2 container walks its directory and
+    copies the data, so the detection and the parsers share one instance
+    instead of asking the container again each time.
+  */
+class SubStreamCache
+{
+public:
+  explicit SubStreamCache(librevenge::RVNGInputStream *input);
+
+  librevenge::RVNGInputStream *getInput() const
+  {
+    return m_input;
+  }
+  /** Returns the sub-stream called name, positioned at its start, or
+      nullptr if the document has no such stream. The stream stays owned
+      by the cache.
+    */
+  librevenge::RVNGInputStream *getSubStream(const char *name);
+
+private:
+  SubStreamCache(const SubStreamCache &) = delete;
+  SubStreamCache &operator=(const SubStreamCache &) = delete;
+
+  librevenge::RVNGInputStream *m_input;
+  std::map<std::string, std::unique_ptr<librevenge::RVNGInputStream> > m_subStreams;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_SUBSTREAMCACHE_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -0,0 +1,41 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include "TextArena.h"
+
+namespace libmspub
+{
+
+TextArena::TextArena()
+  : m_text(std::make_shared<std::vector<unsigned char> >())
+{
+}
+
+TextSpan TextArena::append(const std::vector<unsigned char> &chars, const CharacterStyle &style)
+{
+  const std::size_t offset = m_text->size();
+  m_text->insert(m_text->end(), chars.begin(), chars.end());
+  return getSpan(offset, chars.size(), style);
+}
+
+std::size_t TextArena::read(librevenge::RVNGInputStream *input, unsigned long length)
+{
+  const std::size_t offset = m_text->size();
+  if (!input || length == 0)
+    return offset;
+  unsigned long numBytesRead = 0;
+  const unsigned char *data = input->read(length, numBytesRead);
+  if (data)
+    m_text->insert(m_text->end(), data, data + numBytesRead);
+  return offset;
+}
+
+}
+
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
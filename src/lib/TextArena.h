@@ -0,0 +1,64 @@
+/* -*- Mode: C++; tab-width: 2; indent-tabs-mode: nil; c-basic-offset: 2 -*- */
+/*
+ * This file is part of the libmspub project.
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef INCLUDED_TEXTARENA_H
+#define INCLUDED_TEXTARENA_H
+
+#include <memory>
+#include <vector>
+
+#include <librevenge-stream/librevenge-stream.h>
+
+#include "MSPUBTypes.h"
+
+namespace libmspub
+{
+
+/** The bytes of all the text of a document, in one buffer.
+
+    Text spans are ranges of the arena: they share its buffer and find their
+    bytes through it, so the arena can grow while spans are created. The
+    whole text is also what the encoding heuristic looks at.
+  */
+class TextArena
+{
+public:
+  TextArena();
+
+  //! Copies chars at the end of the arena and returns a span on them.
+  TextSpan append(const std::vector<unsigned char> &chars, const CharacterStyle &style);
+  //! Reads up to length bytes of input at the end of the arena, returns the offset of the first one.
+  std::size_t read(librevenge::RVNGInputStream *input, unsigned long length);
+  //! Returns a span on length bytes starting at offset.
+  TextSpan getSpan(std::size_t offset, std::size_t length, const CharacterStyle &style) const
+  {
+    return TextSpan(m_text, offset, length, style);
+  }
+
+  const unsigned char *data() const
+  {
+    return m_text->data();
+  }
+  std::size_t size() const
+  {
+    return m_text->size();
+  }
+  bool empty() const
+  {
+    return m_text->empty();
+  }
+
+private:
+  std::shared_ptr<std::vector<unsigned char> > m_text;
+};
+
+} // namespace libmspub
+
+#endif // INCLUDED_TEXTARENA_H
+/* vim:set shiftwidth=2 softtabstop=2 expandtab: */
@@ -94,6 +94,20 @@ Vector2D VectorTransformation2D::transformWithOrigin(Vector2D v, Vector2D origin
   return transform(v - origin) + origin;
 }
 
+void VectorTransformation2D::transformWithOrigin(std::vector<Vector2D> &points, Vector2D origin) const
+{
+  // the translation, moved back from the origin, is the same for all points
+  const double dx = m_x + origin.m_x;
+  const double dy = m_y + origin.m_y;
+  for (auto &point : points)
+  {
+    const double x = point.m_x - origin.m_x;
+    const double y = point.m_y - origin.m_y;
+    point.m_x = m_m11 * x + m_m12 * y + dx;
+    point.m_y = m_m21 * x + m_m22 * y + dy;
+  }
+}
+
 Vector2D operator+(const Vector2D &l, const Vector2D &r)
 {
   double x = l.m_x + r.m_x;
@@ -10,6 +10,8 @@
 #ifndef INCLUDED_VECTORTRANSFORMATION2D_H
 #define INCLUDED_VECTORTRANSFORMATION2D_H
 
+#include <vector>
+
 namespace libmspub
 {
 struct Vector2D
@@ -31,6 +33,8 @@ public:
   VectorTransformation2D(double m11, double m12, double m21, double m22, double x, double y);
   Vector2D transform(Vector2D original) const;
   Vector2D transformWithOrigin(Vector2D v, Vector2D origin) const;
+  //! Transforms all the points in place, like transformWithOrigin does for one point
+  void transformWithOrigin(std::vector<Vector2D> &points, Vector2D origin) const;
   double getRotation() const;
   double getHorizontalScaling() const;
   double getVerticalScaling() const;
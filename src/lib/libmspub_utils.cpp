@@ -15,10 +15,17 @@
 #include <string.h> // for memcpy
 
 #include <unicode/ucnv.h>
+#include <unicode/utf16.h>
 #include <unicode/utypes.h>
 
 #include <zlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #define ZLIB_CHUNK 16384
 
 namespace libmspub
@@ -211,7 +218,61 @@ librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData deflated)
   return inflated;
 }
 
-void appendUCS4(librevenge::RVNGString &text, unsigned ucs4Character)
+bool decodeBlipData(ImgType type, librevenge::RVNGBinaryData &img)
+{
+  if (type == WMF || type == EMF)
+  {
+    img = inflateData(img);
+  }
+  else if (type == DIB)
+  {
+    // Reconstruct BMP header
+    // cf. http://en.wikipedia.org/wiki/BMP_file_format , accessed 2012-5-31
+    if (img.size() < 0x2E + 4)
+      return false;
+    librevenge::RVNGInputStream *buf = img.getDataStream();
+    buf->seek(0x0E, librevenge::RVNG_SEEK_SET);
+    unsigned short bitsPerPixel = readU16(buf);
+    buf->seek(0x20, librevenge::RVNG_SEEK_SET);
+    unsigned numPaletteColors = readU32(buf);
+    if (numPaletteColors == 0 && bitsPerPixel <= 8)
+    {
+      numPaletteColors = 1;
+      for (int i = 0; i < bitsPerPixel; ++i)
+      {
+        numPaletteColors *= 2;
+      }
+    }
+
+    librevenge::RVNGBinaryData tmpImg;
+    tmpImg.append(static_cast<unsigned char>(0x42));
+    tmpImg.append(static_cast<unsigned char>(0x4d));
+
+    tmpImg.append(static_cast<unsigned char>((img.size() + 14) & 0x000000ff));
+    tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0x0000ff00) >> 8));
+    tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0x00ff0000) >> 16));
+    tmpImg.append(static_cast<unsigned char>(((img.size() + 14) & 0xff000000) >> 24));
+
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+
+    tmpImg.append(static_cast<unsigned char>(0x36 + 4 * numPaletteColors));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(static_cast<unsigned char>(0x00));
+    tmpImg.append(img);
+    img = tmpImg;
+  }
+  return true;
+}
+
+namespace
+{
+
+//! Writes the UTF-8 form of ucs4Character to outbuf, which has room for 6 bytes; returns the number of bytes written
+int encodeUTF8(unsigned ucs4Character, char *outbuf)
 {
   unsigned char first;
   int len;
@@ -246,15 +307,21 @@ void appendUCS4(librevenge::RVNGString &text, unsigned ucs4Character)
     len = 6;
   }
 
-  char outbuf[7] = { 0 };
-  int i;
-  for (i = len - 1; i > 0; --i)
+  for (int i = len - 1; i > 0; --i)
   {
     outbuf[i] = char((ucs4Character & 0x3f) | 0x80);
     ucs4Character >>= 6;
   }
   outbuf[0] = char((ucs4Character & 0xff) | first);
-  outbuf[len] = '\0';
+  return len;
+}
+
+} // anonymous namespace
+
+void appendUCS4(librevenge::RVNGString &text, unsigned ucs4Character)
+{
+  char outbuf[7] = { 0 };
+  outbuf[encodeUTF8(ucs4Character, outbuf)] = '\0';
 
   text.append(outbuf);
 }
@@ -373,33 +440,229 @@ unsigned long getLength(librevenge::RVNGInputStream *const input)
   return end;
 }
 
-void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters,
-                      const char *encoding)
+ConverterCache::ConverterCache()
+  : m_converters()
+{
+}
+
+ConverterCache::~ConverterCache()
 {
-  if (characters.empty())
+  for (auto &converter : m_converters)
   {
-    MSPUB_DEBUG_MSG(("libmspub_utils[appendCharacters]: Attempt to append 0 characters!\n"));
-    return;
+    if (converter.second)
+      ucnv_close(converter.second);
   }
+}
 
-  UErrorCode status = U_ZERO_ERROR;
-  UConverter *conv = nullptr;
-  conv = ucnv_open(encoding, &status);
-  if (U_SUCCESS(status))
+UConverter *ConverterCache::get(const char *encoding)
+{
+  const std::string name(encoding ? encoding : "");
+  auto it = m_converters.find(name);
+  if (it == m_converters.end())
   {
-    // ICU documentation claims that character-by-character processing is faster "for small amounts of data" and "'normal' charsets"
-    // (in any case, it is more convenient :) )
-    const char *src = reinterpret_cast<const char *>(characters.data());
-    const char *srcLimit = src + characters.size();
-    while (src < srcLimit)
+    UErrorCode status = U_ZERO_ERROR;
+    UConverter *conv = ucnv_open(encoding, &status);
+    if (U_FAILURE(status) && conv)
     {
-      auto ucs4Character = uint32_t(ucnv_getNextUChar(conv, &src, srcLimit, &status));
-      if (U_SUCCESS(status))
+      ucnv_close(conv);
+      conv = nullptr;
+    }
+    // remember failures too, to not try again for each span
+    it = m_converters.insert(std::make_pair(name, conv)).first;
+  }
+  return it->second;
+}
+
+namespace
+{
+
+//! Appends the UTF-8 form of c to utf8; skips NUL, as appendUCS4 does, since it would end the string
+void appendUTF8(std::vector<char> &utf8, UChar32 c)
+{
+  if (c == 0)
+    return;
+  char bytes[6];
+  const int len = encodeUTF8(unsigned(c), bytes);
+  utf8.insert(utf8.end(), bytes, bytes + len);
+}
+
+void appendUTF8(librevenge::RVNGString &text, std::vector<char> &utf8)
+{
+  if (utf8.empty())
+    return;
+  utf8.push_back('\0');
+  text.append(utf8.data());
+}
+
+//! Appends UTF-16 code units to text as UTF-8, at once
+void appendUTF16(librevenge::RVNGString &text, const UChar *characters, int32_t length)
+{
+  std::vector<char> utf8;
+  utf8.reserve(3 * size_t(length) + 1);
+  int32_t i = 0;
+  while (i < length)
+  {
+    UChar32 c;
+    U16_NEXT(characters, i, length, c);
+    appendUTF8(utf8, c);
+  }
+  appendUTF8(text, utf8);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define MSPUB_LITTLE_ENDIAN 1
+#endif
+
+/** Copies the ASCII characters at the start of UTF-16LE text to out, one
+    byte per code unit, and returns the number of bytes of text consumed.
+
+    It stops before the first block holding a code unit which is not ASCII
+    or is NUL; the caller decodes from there one character at a time.
+  */
+unsigned long copyASCIIUTF16LE(const unsigned char *characters, unsigned long length, char *out)
+{
+  unsigned long i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i nonASCII = _mm_set1_epi16(short(0xff80));
+  for (; i + 16 <= length; i += 16)
+  {
+    const __m128i units = _mm_loadu_si128(reinterpret_cast<const __m128i *>(characters + i));
+    const __m128i ascii = _mm_cmpeq_epi16(_mm_and_si128(units, nonASCII), zero);
+    const __m128i nul = _mm_cmpeq_epi16(units, zero);
+    if (_mm_movemask_epi8(_mm_andnot_si128(nul, ascii)) != 0xffff)
+      break;
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(out + i / 2), _mm_packus_epi16(units, units));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__) && defined(MSPUB_LITTLE_ENDIAN)
+  for (; i + 16 <= length; i += 16)
+  {
+    const uint16x8_t units = vreinterpretq_u16_u8(vld1q_u8(characters + i));
+    if (vmaxvq_u16(units) >= 0x80 || vminvq_u16(units) == 0)
+      break;
+    vst1_u8(reinterpret_cast<uint8_t *>(out + i / 2), vmovn_u16(units));
+  }
+#endif
+#ifdef MSPUB_LITTLE_ENDIAN
+  // four code units at a time: no high byte, no bit 7, and no NUL
+  for (; i + 8 <= length; i += 8)
+  {
+    uint64_t units;
+    memcpy(&units, characters + i, 8);
+    if ((units & 0xff80ff80ff80ff80ULL) || ((units + 0x007f007f007f007fULL) & 0x0080008000800080ULL) != 0x0080008000800080ULL)
+      break;
+    char *const dest = out + i / 2;
+    dest[0] = char(characters[i]);
+    dest[1] = char(characters[i + 2]);
+    dest[2] = char(characters[i + 4]);
+    dest[3] = char(characters[i + 6]);
+  }
+#endif
+  return i;
+}
+
+/** Appends UTF-16LE text as UTF-8, without going through ICU.
+
+    Runs of ASCII characters, the bulk of most texts, are copied in blocks
+    by copyASCIIUTF16LE. Unpaired surrogates and a trailing odd byte become
+    U+FFFD, like ICU's default substitution does.
+  */
+void appendUTF16LE(librevenge::RVNGString &text, const unsigned char *characters, unsigned long length)
+{
+  // a code unit gives at most 3 bytes, a surrogate pair 4
+  std::vector<char> utf8(3 * (length / 2) + 8);
+  char *const out = utf8.data();
+  size_t outPos = 0;
+  unsigned long i = 0;
+  while (i + 1 < length)
+  {
+    const unsigned long asciiLength = copyASCIIUTF16LE(characters + i, length - i, out + outPos);
+    i += asciiLength;
+    outPos += asciiLength / 2;
+    if (i + 1 >= length)
+      break;
+    UChar32 c = UChar32(characters[i] | (characters[i + 1] << 8));
+    i += 2;
+    if (U16_IS_SURROGATE(c))
+    {
+      if (U16_IS_SURROGATE_LEAD(c) && i + 1 < length)
+      {
+        const UChar32 trail = UChar32(characters[i] | (characters[i + 1] << 8));
+        if (U16_IS_TRAIL(trail))
+        {
+          c = U16_GET_SUPPLEMENTARY(c, trail);
+          i += 2;
+        }
+        else
+          c = 0xfffd;
+      }
+      else
       {
-        appendUCS4(text, ucs4Character);
+        if (U16_IS_SURROGATE_LEAD(c))
+          i = length; // a truncated pair, with the odd byte that may follow, is one bad character
+        c = 0xfffd;
       }
     }
+    // skip NUL, as appendUCS4 does, since it would end the string
+    if (c)
+      outPos += size_t(encodeUTF8(unsigned(c), out + outPos));
+  }
+  if (i < length)
+    outPos += size_t(encodeUTF8(0xfffd, out + outPos));
+  utf8.resize(outPos);
+  appendUTF8(text, utf8);
+}
+
+void convertCharacters(librevenge::RVNGString &text, UConverter *conv, const unsigned char *characters, unsigned long length)
+{
+  const auto src = reinterpret_cast<const char *>(characters);
+  // most encodings give at most two UTF-16 code units for a byte
+  std::vector<UChar> uchars(2 * length + 1);
+  UErrorCode status = U_ZERO_ERROR;
+  int32_t numUChars = ucnv_toUChars(conv, uchars.data(), int32_t(uchars.size()), src, int32_t(length), &status);
+  if (status == U_BUFFER_OVERFLOW_ERROR)
+  {
+    uchars.resize(size_t(numUChars) + 1);
+    status = U_ZERO_ERROR;
+    numUChars = ucnv_toUChars(conv, uchars.data(), int32_t(uchars.size()), src, int32_t(length), &status);
   }
+  if (U_SUCCESS(status) || status == U_STRING_NOT_TERMINATED_WARNING)
+    appendUTF16(text, uchars.data(), numUChars);
+}
+
+} // anonymous namespace
+
+void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters,
+                      const char *encoding, ConverterCache *cache)
+{
+  appendCharacters(text, characters.data(), characters.size(), encoding, cache);
+}
+
+void appendCharacters(librevenge::RVNGString &text, const unsigned char *characters, unsigned long length,
+                      const char *encoding, ConverterCache *cache)
+{
+  if (!characters || length == 0)
+  {
+    MSPUB_DEBUG_MSG(("libmspub_utils[appendCharacters]: Attempt to append 0 characters!\n"));
+    return;
+  }
+
+  if (encoding && std::strcmp(encoding, "UTF-16LE") == 0)
+  {
+    appendUTF16LE(text, characters, length);
+    return;
+  }
+  if (cache)
+  {
+    UConverter *conv = cache->get(encoding);
+    if (conv)
+      convertCharacters(text, conv, characters, length);
+    return;
+  }
+  UErrorCode status = U_ZERO_ERROR;
+  UConverter *conv = ucnv_open(encoding, &status);
+  if (U_SUCCESS(status))
+    convertCharacters(text, conv, characters, length);
   if (conv)
   {
     ucnv_close(conv);
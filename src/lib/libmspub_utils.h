@@ -15,6 +15,8 @@
 #endif
 
 #include <cmath>
+#include <map>
+#include <string>
 #include <vector>
 
 #include <boost/cstdint.hpp>
@@ -58,6 +60,8 @@ void debugPrint(const char *format, ...) MSPUB_ATTRIBUTE_PRINTF(1, 2);
 
 #define MSPUB_N_ELEMENTS(m) sizeof(m)/sizeof(m[0])
 
+struct UConverter;
+
 namespace libmspub
 {
 const char *mimeByImgType(ImgType type);
@@ -76,8 +80,30 @@ void readNBytes(librevenge::RVNGInputStream *input, unsigned long length, std::v
 
 unsigned long getLength(librevenge::RVNGInputStream *input);
 
+/** The ICU converters used to decode the text of a document, by encoding name.
+
+    A converter is opened the first time its encoding is seen, and kept
+    until the cache is destroyed.
+  */
+class ConverterCache
+{
+public:
+  ConverterCache();
+  ~ConverterCache();
+  ConverterCache(const ConverterCache &) = delete;
+  ConverterCache &operator=(const ConverterCache &) = delete;
+
+  //! Returns the converter for encoding, or nullptr if ICU does not know it.
+  UConverter *get(const char *encoding);
+
+private:
+  std::map<std::string, UConverter *> m_converters;
+};
+
 void appendUCS4(librevenge::RVNGString &text, unsigned ucs4Character);
-void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters, const char *encoding);
+//! Decodes characters from encoding; uses the converters of cache if given, else opens a converter for this call
+void appendCharacters(librevenge::RVNGString &text, const std::vector<unsigned char> &characters, const char *encoding, ConverterCache *cache = nullptr);
+void appendCharacters(librevenge::RVNGString &text, const unsigned char *characters, unsigned long length, const char *encoding, ConverterCache *cache = nullptr);
 
 bool stillReading(librevenge::RVNGInputStream *input, unsigned long until);
 
@@ -114,6 +140,8 @@ class GenericException
 };
 
 librevenge::RVNGBinaryData inflateData(librevenge::RVNGBinaryData);
+//! Converts the data of an Escher BLIP to a picture file: inflates metafiles, adds the BMP header to DIBs
+bool decodeBlipData(ImgType type, librevenge::RVNGBinaryData &img);
 librevenge::RVNGBinaryData createPNGForSimplePattern(uint8_t const(&pattern)[8], Color const &col0, Color const &col1);
 bool readData(librevenge::RVNGInputStream *input, unsigned long sz, librevenge::RVNGBinaryData &data);
 